@@ -38,7 +38,7 @@ void AbstractSliceComponent::setState(SliceState const state, bool const soloMod
     JUCE_ASSERT_MESSAGE_THREAD;
 
     mMuteSoloComponent.setPortState(state);
-    mVuMeter.setMuted(soloMode ? state != SliceState::solo : state == SliceState::muted);
+    mVuMeter.setMuted(MuteSoloComponent::isMuted(state, soloMode));
 
     repaint();
 }
@@ -20,12 +20,126 @@
 #include "sg_Application.hpp"
 #include "Misc/sg_DefaultFiles.hpp"
 #include "sg_AudioManager.hpp"
+#include "sg_OfflineRenderer.hpp"
+#include "sg_SoakTest.hpp"
+#include "sg_ThreadPlacement.hpp"
+
+#include <iostream>
 
 namespace gris
 {
+namespace
+{
+//==============================================================================
+int renderOffline(juce::ArgumentList const & arguments)
+{
+    juce::String error{};
+    auto const options{ OfflineRenderer::parseOptions(arguments, error) };
+    if (!options) {
+        std::cerr << "Error: " << error << '\n' << OfflineRenderer::getUsage() << std::endl;
+        return 1;
+    }
+
+    OfflineRenderer renderer{ *options };
+    return renderer.run();
+}
+
+//==============================================================================
+std::unique_ptr<HeadlessServer> startHeadlessServer(juce::ArgumentList const & arguments)
+{
+    juce::String error{};
+    auto const options{ HeadlessServer::parseOptions(arguments, error) };
+    if (!options) {
+        std::cerr << "Error: " << error << '\n' << HeadlessServer::getUsage() << std::endl;
+        return nullptr;
+    }
+
+    auto server{ std::make_unique<HeadlessServer>(*options) };
+    if (!server->start(error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return nullptr;
+    }
+    return server;
+}
+
+//==============================================================================
+std::unique_ptr<SoakTest> startSoakTest(juce::ArgumentList const & arguments)
+{
+    juce::String error{};
+    auto const options{ SoakTest::parseOptions(arguments, error) };
+    if (!options) {
+        std::cerr << "Error: " << error << '\n' << SoakTest::getUsage() << std::endl;
+        return nullptr;
+    }
+
+    auto soakTest{ std::make_unique<SoakTest>(*options) };
+    if (!soakTest->start(error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return nullptr;
+    }
+    return soakTest;
+}
+
+//==============================================================================
+/* Must be done before any audio device is opened or any thread is started. */
+bool placeThreads(juce::ArgumentList const & arguments)
+{
+    auto const spec{ arguments.containsOption(threadPlacement::OPTION)
+                         ? arguments.getValueForOption(threadPlacement::OPTION).unquoted()
+                         : threadPlacement::loadSpec() };
+    juce::String error{};
+    auto const placement{ threadPlacement::parse(spec, error) };
+    if (!placement) {
+        std::cerr << "Error: " << error << std::endl;
+        return false;
+    }
+
+    threadPlacement::configure(*placement);
+    if (!threadPlacement::applyToCurrentThread(threadPlacement::Role::ui)) {
+        std::cerr << "Warning: unable to place the message thread." << std::endl;
+    }
+    if (!threadPlacement::lockMemoryIfNeeded()) {
+        std::cerr << "Warning: unable to lock the memory." << std::endl;
+    }
+    return true;
+}
+
+} // namespace
+
 //==============================================================================
 void SpatGrisApplication::initialise(juce::String const & /*commandLine*/)
 {
+    juce::ArgumentList const arguments{ getApplicationName(), getCommandLineParameterArray() };
+    if (!placeThreads(arguments)) {
+        setApplicationReturnValue(1);
+        quit();
+        return;
+    }
+
+    if (arguments.containsOption(OfflineRenderer::RENDER_OPTION)) {
+        setApplicationReturnValue(renderOffline(arguments));
+        quit();
+        return;
+    }
+
+    if (arguments.containsOption(SoakTest::SOAK_OPTION)) {
+        mSoakTest = startSoakTest(arguments);
+        if (!mSoakTest) {
+            setApplicationReturnValue(1);
+            quit();
+        }
+        return;
+    }
+
+    if (arguments.containsOption(HeadlessServer::HEADLESS_OPTION)) {
+        mHeadlessServer = startHeadlessServer(arguments);
+        if (!mHeadlessServer) {
+            setApplicationReturnValue(1);
+            quit();
+        }
+        return;
+    }
+
     // Make sure that the manual can be found.
     jassert(MANUAL_FILE_EN.existsAsFile());
     jassert(MANUAL_FILE_FR.existsAsFile());
@@ -37,13 +151,16 @@ void SpatGrisApplication::initialise(juce::String const & /*commandLine*/)
 void SpatGrisApplication::shutdown()
 {
     mMainWindow.reset();
+    mSoakTest.reset();
+    mHeadlessServer.reset();
     AudioManager::free();
 }
 
 //==============================================================================
 void SpatGrisApplication::systemRequestedQuit()
 {
-    if (mMainWindow->exitWinApp()) {
+    // There is no window when rendering offline, running headless or soak testing.
+    if (!mMainWindow || mMainWindow->exitWinApp()) {
         quit();
     }
 }
@@ -20,7 +20,9 @@
 #pragma once
 
 #include "sg_GrisLookAndFeel.hpp"
+#include "sg_HeadlessServer.hpp"
 #include "sg_MainWindow.hpp"
+#include "sg_SoakTest.hpp"
 
 namespace gris
 {
@@ -28,6 +30,8 @@ namespace gris
 class SpatGrisApplication final : public juce::JUCEApplication
 {
     std::unique_ptr<MainWindow> mMainWindow{};
+    std::unique_ptr<HeadlessServer> mHeadlessServer{};
+    std::unique_ptr<SoakTest> mSoakTest{};
     GrisLookAndFeel mGrisFeel{};
     SmallGrisLookAndFeel mSmallLookAndFeel{};
 
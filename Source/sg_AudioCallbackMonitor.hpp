@@ -0,0 +1,244 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_AtomicUpdater.hpp"
+#include "Data/sg_Macros.hpp"
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace gris
+{
+/* Timing and dropout statistics of the audio callback.
+
+   The audio thread owns an AudioCallbackMonitor. It timestamps every callback,
+   measures how long the block took to process and counts the blocks it had to
+   skip, then publishes a copy of its statistics through an AtomicUpdater at the
+   end of the callback. The message thread only ever reads the most recent copy,
+   so nothing here locks or allocates on the audio thread.
+
+   Device xruns are not visible from the callback : the message thread reads them
+   from the AudioIODevice and reports them relative to the last reset.
+*/
+
+//==============================================================================
+/* Why the audio callback returned without processing a block. */
+enum class SkippedBlockReason { playerLoading, processorLocked, noConfig, bufferSizeMismatch };
+
+constexpr std::size_t NUM_SKIPPED_BLOCK_REASONS = 4;
+
+[[nodiscard]] inline juce::String skippedBlockReasonToString(SkippedBlockReason const reason)
+{
+    switch (reason) {
+    case SkippedBlockReason::playerLoading:
+        return "player loading";
+    case SkippedBlockReason::processorLocked:
+        return "processor locked";
+    case SkippedBlockReason::noConfig:
+        return "no config";
+    case SkippedBlockReason::bufferSizeMismatch:
+        return "buffer size mismatch";
+    }
+    jassertfalse;
+    return {};
+}
+
+//==============================================================================
+/* Logarithmic histogram of durations, with four buckets per octave from 1 µs
+   up to about one second. Percentiles are reported as the upper edge of their
+   bucket, which is at most 19 % above the actual value. */
+struct DurationHistogram {
+    static constexpr int BUCKETS_PER_OCTAVE = 4;
+    static constexpr int NUM_BUCKETS = 20 * BUCKETS_PER_OCTAVE;
+
+    std::array<std::uint32_t, NUM_BUCKETS> buckets{};
+    std::uint64_t count{};
+    double maxMs{};
+
+    //==============================================================================
+    void add(double const ms) noexcept
+    {
+        auto const us{ ms * 1000.0 };
+        auto const index{ us <= 1.0 ? 0 : static_cast<int>(std::log2(us) * BUCKETS_PER_OCTAVE) };
+        ++buckets[static_cast<std::size_t>(juce::jlimit(0, NUM_BUCKETS - 1, index))];
+        ++count;
+        maxMs = std::max(maxMs, ms);
+    }
+
+    //==============================================================================
+    [[nodiscard]] double getPercentileMs(double const percentile) const noexcept
+    {
+        if (count == 0) {
+            return 0.0;
+        }
+
+        auto const target{ static_cast<std::uint64_t>(std::ceil(static_cast<double>(count) * percentile / 100.0)) };
+        std::uint64_t accumulated{};
+        for (int i{}; i < NUM_BUCKETS; ++i) {
+            accumulated += buckets[static_cast<std::size_t>(i)];
+            if (accumulated >= target) {
+                auto const upperEdgeUs{ std::exp2(static_cast<double>(i + 1) / BUCKETS_PER_OCTAVE) };
+                return std::min(upperEdgeUs / 1000.0, maxMs);
+            }
+        }
+        return maxMs;
+    }
+};
+
+//==============================================================================
+struct AudioCallbackStats {
+    // Time spent between the start and the end of the processed blocks.
+    DurationHistogram processingTime{};
+    // Distance between the actual and the expected interval between two callbacks.
+    DurationHistogram jitter{};
+    std::array<std::uint64_t, NUM_SKIPPED_BLOCK_REASONS> skippedBlocks{};
+    std::uint64_t numCallbacks{};
+    // The duration of the last block, in ms.
+    double blockDurationMs{};
+    // Sources left out of the spatialization because they were quiet or muted, and quiet sources rendered anyway to
+    // finish their tail (see SilenceGate), in the last processed block.
+    int numSources{};
+    int numSkippedSources{};
+    int numHeldSources{};
+    // Summed over all the processed blocks.
+    std::uint64_t totalSkippedSources{};
+    //==============================================================================
+    [[nodiscard]] std::uint64_t getNumSkippedBlocks() const noexcept
+    {
+        std::uint64_t result{};
+        for (auto const numSkipped : skippedBlocks) {
+            result += numSkipped;
+        }
+        return result;
+    }
+};
+
+//==============================================================================
+class AudioCallbackMonitor
+{
+public:
+    using Updater = AtomicUpdater<AudioCallbackStats>;
+
+private:
+    //==============================================================================
+    Updater mUpdater{};
+    std::atomic<bool> mResetRequested{};
+    // Audio thread.
+    AudioCallbackStats mStats{};
+    juce::int64 mLastCallbackTicks{};
+    // Message thread.
+    Updater::Token * mMostRecent{};
+    int mXRunsAtReset{};
+
+public:
+    //==============================================================================
+    AudioCallbackMonitor() = default;
+    ~AudioCallbackMonitor() = default;
+    SG_DELETE_COPY_AND_MOVE(AudioCallbackMonitor)
+    //==============================================================================
+    /* Audio thread. Returns the timestamp to pass to endBlock(). */
+    [[nodiscard]] juce::int64 startBlock(int const numSamples, double const sampleRate) noexcept
+    {
+        auto const now{ juce::Time::getHighResolutionTicks() };
+
+        if (mResetRequested.exchange(false, std::memory_order_acquire)) {
+            mStats = AudioCallbackStats{};
+        }
+
+        mStats.blockDurationMs = sampleRate > 0.0 ? numSamples * 1000.0 / sampleRate : 0.0;
+        if (mLastCallbackTicks != 0 && sampleRate > 0.0) {
+            auto const intervalMs{ juce::Time::highResolutionTicksToSeconds(now - mLastCallbackTicks) * 1000.0 };
+            mStats.jitter.add(std::abs(intervalMs - mStats.blockDurationMs));
+        }
+        mLastCallbackTicks = now;
+        ++mStats.numCallbacks;
+
+        return now;
+    }
+
+    /* Audio thread. */
+    void skipBlock(SkippedBlockReason const reason) noexcept
+    {
+        ++mStats.skippedBlocks[static_cast<std::size_t>(reason)];
+        publish();
+    }
+
+    /* Audio thread. Call before endBlock() for the blocks that were processed. */
+    void setSourceActivity(int const numSources, int const numSkippedSources, int const numHeldSources) noexcept
+    {
+        mStats.numSources = numSources;
+        mStats.numSkippedSources = numSkippedSources;
+        mStats.numHeldSources = numHeldSources;
+        mStats.totalSkippedSources += static_cast<std::uint64_t>(numSkippedSources);
+    }
+
+    /* Audio thread. */
+    void endBlock(juce::int64 const startTicks) noexcept
+    {
+        auto const elapsedTicks{ juce::Time::getHighResolutionTicks() - startTicks };
+        mStats.processingTime.add(juce::Time::highResolutionTicksToSeconds(elapsedTicks) * 1000.0);
+        publish();
+    }
+
+    /* Must be called while the device is stopped, so that the pause is not reported as jitter. */
+    void deviceAboutToStart() noexcept { mLastCallbackTicks = 0; }
+
+    //==============================================================================
+    /* Message thread. Returns nullptr until the first callback. */
+    [[nodiscard]] AudioCallbackStats const * getMostRecentStats() noexcept
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+        mUpdater.getMostRecent(mMostRecent);
+        return mMostRecent ? &mMostRecent->get() : nullptr;
+    }
+
+    /* Message thread. Returns -1 if the device does not report xruns. */
+    [[nodiscard]] int getXRunsSinceReset(juce::AudioIODevice & device) const
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+        auto const xRuns{ device.getXRunCount() };
+        return xRuns < 0 ? -1 : std::max(0, xRuns - mXRunsAtReset);
+    }
+
+    /* Message thread. */
+    void reset(juce::AudioIODevice * device) noexcept
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+        mXRunsAtReset = device ? std::max(0, device->getXRunCount()) : 0;
+        mResetRequested.store(true, std::memory_order_release);
+    }
+
+private:
+    //==============================================================================
+    void publish() noexcept
+    {
+        auto * ticket{ mUpdater.acquire() };
+        ticket->get() = mStats;
+        mUpdater.setMostRecent(ticket);
+    }
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(AudioCallbackMonitor)
+};
+} // namespace gris
@@ -0,0 +1,159 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace gris
+{
+/* Per-channel loops of the audio callback that do several things to a buffer
+   while it is in registers, instead of going over it once per operation.
+
+   The vector paths use juce::dsp::SIMDRegister, which maps to AVX2 when the
+   compiler targets it, to SSE otherwise on x86 and to NEON on ARM. Every
+   function has a scalar path for the unaligned head and tail of the buffer and
+   for builds where JUCE_USE_SIMD is 0.
+*/
+namespace kernels
+{
+// Far above the denormal range of floats and far below anything audible.
+constexpr double DENORMAL_NOISE = 1e-18;
+
+#if JUCE_USE_SIMD
+using FloatVector = juce::dsp::SIMDRegister<float>;
+#endif
+
+//==============================================================================
+/* Multiplies the samples by gain and returns the peak of the result. */
+[[nodiscard]] inline float applyGainAndGetPeak(float * samples, int const numSamples, float const gain) noexcept
+{
+    auto * const end{ samples + numSamples };
+    auto peak{ 0.0f };
+
+#if JUCE_USE_SIMD
+    auto * const alignedStart{ std::min(FloatVector::getNextSIMDAlignedPtr(samples), end) };
+    for (; samples < alignedStart; ++samples) {
+        *samples *= gain;
+        peak = std::max(peak, std::abs(*samples));
+    }
+
+    auto const gains{ FloatVector::expand(gain) };
+    auto peaks{ FloatVector::expand(0.0f) };
+    for (; samples + FloatVector::size() <= end; samples += FloatVector::size()) {
+        auto const values{ FloatVector::fromRawArray(samples) * gains };
+        values.copyToRawArray(samples);
+        peaks = FloatVector::max(peaks, FloatVector::abs(values));
+    }
+    for (std::size_t lane{}; lane < FloatVector::size(); ++lane) {
+        peak = std::max(peak, peaks.get(lane));
+    }
+#endif
+
+    for (; samples < end; ++samples) {
+        *samples *= gain;
+        peak = std::max(peak, std::abs(*samples));
+    }
+
+    return peak;
+}
+
+//==============================================================================
+/* Copies the samples and returns their peak.
+
+   Device buffers have no alignment guarantee, so the samples are copied in
+   chunks and the peak is measured on the copy while it is still in L1. */
+[[nodiscard]] inline float copyAndGetPeak(float const * source, float * destination, int const numSamples) noexcept
+{
+    static constexpr int CHUNK_SIZE = 64;
+
+    auto peak{ 0.0f };
+    for (int start{}; start < numSamples; start += CHUNK_SIZE) {
+        auto const chunkSize{ std::min(CHUNK_SIZE, numSamples - start) };
+        juce::FloatVectorOperations::copy(destination + start, source + start, chunkSize);
+        auto const range{ juce::FloatVectorOperations::findMinAndMax(destination + start, chunkSize) };
+        peak = std::max({ peak, range.getEnd(), -range.getStart() });
+    }
+    return peak;
+}
+
+//==============================================================================
+/* Applies gain, then the highpass filter, and returns the peak of the result, in a single loop over the samples.
+
+   The filter is recursive, so it cannot be vectorized across time : the gain
+   and the peak are folded into its per-sample loop instead, so that every
+   sample is loaded and stored once. The recursion is the one of
+   SpeakerHighpassConfig::process(), and so is the remedy against denormals :
+   a tiny random offset is added to every input sample. The output matches the
+   reference within that noise, see kernelBenchmark::measure(). */
+template<typename HighpassConfig, typename HighpassState>
+[[nodiscard]] float applyGainHighpassAndGetPeak(float * samples,
+                                                int const numSamples,
+                                                float const gain,
+                                                HighpassConfig const & highpassConfig,
+                                                HighpassState & highpassState,
+                                                juce::Random & randomNoise) noexcept
+{
+    auto const ha0{ highpassConfig.ha0 };
+    auto const ha1{ highpassConfig.ha1 };
+    auto const ha2{ highpassConfig.ha2 };
+    auto const b1{ highpassConfig.b1 };
+    auto const b2{ highpassConfig.b2 };
+    auto const b3{ highpassConfig.b3 };
+    auto const b4{ highpassConfig.b4 };
+    auto x1{ highpassState.x1 };
+    auto x2{ highpassState.x2 };
+    auto x3{ highpassState.x3 };
+    auto x4{ highpassState.x4 };
+    auto y1{ highpassState.y1 };
+    auto y2{ highpassState.y2 };
+    auto y3{ highpassState.y3 };
+    auto y4{ highpassState.y4 };
+
+    auto peak{ 0.0 };
+    for (int i{}; i < numSamples; ++i) {
+        auto const x{ static_cast<double>(samples[i] * gain) + (randomNoise.nextDouble() - 0.5) * DENORMAL_NOISE };
+        auto const y{ ha0 * x + ha1 * x1 + ha2 * x2 + ha1 * x3 + ha0 * x4 - b1 * y1 - b2 * y2 - b3 * y3 - b4 * y4 };
+        x4 = x3;
+        x3 = x2;
+        x2 = x1;
+        x1 = x;
+        y4 = y3;
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+        samples[i] = static_cast<float>(y);
+        peak = std::max(peak, std::abs(y));
+    }
+
+    highpassState.x1 = x1;
+    highpassState.x2 = x2;
+    highpassState.x3 = x3;
+    highpassState.x4 = x4;
+    highpassState.y1 = y1;
+    highpassState.y2 = y2;
+    highpassState.y3 = y3;
+    highpassState.y4 = y4;
+    return static_cast<float>(peak);
+}
+} // namespace kernels
+} // namespace gris
@@ -20,7 +20,12 @@
 #include "sg_AudioManager.hpp"
 
 #include "Data/sg_constants.hpp"
+#include "sg_AudioKernels.hpp"
 #include "sg_AudioProcessor.hpp"
+#include "sg_SimulatedAudioDevice.hpp"
+
+#include <cstdint>
+#include <limits>
 
 // #define SIMULATE_NO_AUDIO_DEVICES
 
@@ -43,17 +48,81 @@ juce::BigInteger const NEEDED_OUTPUT_CHANNELS{ [] {
 //==============================================================================
 std::unique_ptr<AudioManager> AudioManager::mInstance{ nullptr };
 
+namespace
+{
+//==============================================================================
+/* Makes the device buffers of the bank refer to the memory of the audio device, so that the processor reads the
+ * inputs and writes the outputs in place.
+ *
+ * This is only possible when every source has a device input and every speaker a device output, and when inputs and
+ * outputs do not share memory : speakers are written while sources are still being read. The caller must also make
+ * sure that no source is being faded, see AudioProcessor::areSourcesFading(). */
+bool tryReferToDeviceBuffers(AudioProcessor::BufferBank & bank,
+                             float const * const * inputChannelData,
+                             int const totalNumInputChannels,
+                             float * const * outputChannelData,
+                             int const totalNumOutputChannels,
+                             int const numSamples) noexcept
+{
+    auto const bytesPerChannel{ static_cast<std::uintptr_t>(numSamples) * sizeof(float) };
+    auto lowestInput{ std::numeric_limits<std::uintptr_t>::max() };
+    std::uintptr_t highestInput{};
+    auto lowestOutput{ std::numeric_limits<std::uintptr_t>::max() };
+    std::uintptr_t highestOutput{};
+
+    for (auto const channel : bank.deviceInputBuffer) {
+        auto const index{ channel.key.removeOffset<int>() };
+        if (index >= totalNumInputChannels || inputChannelData[index] == nullptr) {
+            return false;
+        }
+        auto const address{ reinterpret_cast<std::uintptr_t>(inputChannelData[index]) };
+        lowestInput = std::min(lowestInput, address);
+        highestInput = std::max(highestInput, address + bytesPerChannel);
+    }
+    for (auto const channel : bank.deviceOutputBuffer) {
+        auto const index{ channel.key.removeOffset<int>() };
+        if (index >= totalNumOutputChannels || outputChannelData[index] == nullptr) {
+            return false;
+        }
+        auto const address{ reinterpret_cast<std::uintptr_t>(outputChannelData[index]) };
+        lowestOutput = std::min(lowestOutput, address);
+        highestOutput = std::max(highestOutput, address + bytesPerChannel);
+    }
+    if (lowestInput < highestOutput && lowestOutput < highestInput) {
+        return false;
+    }
+
+    // The processor does not write to its sources while none of them is fading.
+    for (auto const channel : bank.deviceInputBuffer) {
+        auto const index{ channel.key.removeOffset<int>() };
+        channel.value->setDataToReferTo(const_cast<float * const *>(inputChannelData + index), 1, numSamples);
+    }
+    for (auto const channel : bank.deviceOutputBuffer) {
+        auto const index{ channel.key.removeOffset<int>() };
+        channel.value->setDataToReferTo(outputChannelData + index, 1, numSamples);
+    }
+    return true;
+}
+} // namespace
+
 //==============================================================================
 AudioManager::AudioManager(juce::String const & deviceType,
                            juce::String const & inputDevice,
                            juce::String const & outputDevice,
                            double const pSampleRate,
                            int const pBufferSize,
-                           tl::optional<StereoRouting> const & stereoRouting)
+                           tl::optional<StereoRouting> const & stereoRouting,
+                           bool const withSimulatedDevice)
     : mStereoRouting(stereoRouting)
 {
     JUCE_ASSERT_MESSAGE_THREAD;
 
+    if (withSimulatedDevice) {
+        // Creating the default types first keeps the simulated device at the end of the list.
+        mAudioDeviceManager.getAvailableDeviceTypes();
+        mAudioDeviceManager.addAudioDeviceType(std::make_unique<SimulatedAudioIODeviceType>());
+    }
+
 #ifndef SIMULATE_NO_AUDIO_DEVICES
     auto const success{ tryInitAudioDevice(deviceType, inputDevice, outputDevice, pSampleRate, pBufferSize) };
 
@@ -80,37 +149,81 @@ void AudioManager::audioDeviceIOCallbackWithContext(const float * const * inputC
                                                     int numSamples,
                                                     [[maybe_unused]] const juce::AudioIODeviceCallbackContext & context)
 {
-    jassert(numSamples <= mInputBuffer.MAX_NUM_SAMPLES);
-    jassert(numSamples <= mOutputBuffer.MAX_NUM_SAMPLES);
-
-    if (!mAudioProcessor || mIsPlayerLoading) {
+    if (!mAudioProcessor) {
         return;
     }
 
-    // clear buffers
-    mInputBuffer.silence();
-    if (mStereoRouting) {
-        mStereoOutputBuffer.clear();
+    if (auto const threadId{ juce::Thread::getCurrentThreadId() }; threadId != mAudioThreadId) {
+        mAudioThreadId = threadId;
+        threadPlacement::applyToCurrentThread(threadPlacement::Role::audio);
+    }
+
+    auto const blockStart{ mCallbackMonitor.startBlock(numSamples, mSampleRate) };
+
+    if (mIsPlayerLoading) {
+        mCallbackMonitor.skipBlock(SkippedBlockReason::playerLoading);
+        return;
     }
-    // TODO: should not process if stereo mode is hrtf
-    mOutputBuffer.silence();
 
     std::for_each_n(outputChannelData, totalNumOutputChannels, [numSamples](float * const data) {
         std::fill_n(data, numSamples, 0.0f);
     });
 
+    // Config changes and algorithm swaps never hold this lock : only structural changes such as the recorders do.
     juce::ScopedTryLock const lock{ mAudioProcessor->getLock() };
     if (!lock.isLocked()) {
+        mCallbackMonitor.skipBlock(SkippedBlockReason::processorLocked);
         return;
     }
 
+    mAudioProcessor->adoptPendingConfig();
+    auto * bufferBank{ mAudioProcessor->getActiveBufferBank() };
+    if (!bufferBank) {
+        mCallbackMonitor.skipBlock(SkippedBlockReason::noConfig);
+        return;
+    }
+    if (bufferBank->inputBuffer.getNumSamples() != numSamples) {
+        // The buffers matching a new buffer size have not been published yet.
+        mCallbackMonitor.skipBlock(SkippedBlockReason::bufferSizeMismatch);
+        return;
+    }
+
+    // When the player and the stereo routing are not in use and no source is fading, the processor can work directly in
+    // the device memory.
+    auto const isReferringToDevice{ !isPlaying() && !mStereoRouting && !mAudioProcessor->areSourcesFading()
+                                    && tryReferToDeviceBuffers(*bufferBank,
+                                                               inputChannelData,
+                                                               totalNumInputChannels,
+                                                               outputChannelData,
+                                                               totalNumOutputChannels,
+                                                               numSamples) };
+
+    auto & inputBuffer{ isReferringToDevice ? bufferBank->deviceInputBuffer : bufferBank->inputBuffer };
+    auto & outputBuffer{ isReferringToDevice ? bufferBank->deviceOutputBuffer : bufferBank->outputBuffer };
+    auto & stereoOutputBuffer{ bufferBank->stereoBuffer };
+
+    jassert(numSamples <= inputBuffer.MAX_NUM_SAMPLES);
+    jassert(numSamples <= outputBuffer.MAX_NUM_SAMPLES);
+
+    // clear buffers
+    if (mStereoRouting) {
+        stereoOutputBuffer.clear();
+    }
+    if (!isReferringToDevice) {
+        inputBuffer.silence();
+        // TODO: should not process if stereo mode is hrtf
+        outputBuffer.silence();
+    }
+
     // if there is a player, copy audio file data to buffers, if not,
     // copy input data to buffers
-    if (isPlaying()) {
+    if (isReferringToDevice) {
+        // The inputs are already in place and the outputs were zeroed above.
+    } else if (isPlaying()) {
         auto const numInputChannelsToCopy{ mTransportSources.size() };
         for (int i{}; i < numInputChannelsToCopy; ++i) {
             source_index_t const sourceIndex{ mTransportSourcesIndexes[i]->get() };
-            auto & buffer{ mInputBuffer[sourceIndex] };
+            auto & buffer{ inputBuffer[sourceIndex] };
             juce::AudioSourceChannelInfo const info{ buffer };
             mTransportSources.getUnchecked(i)->getNextAudioBlock(info);
 
@@ -121,34 +234,37 @@ void AudioManager::audioDeviceIOCallbackWithContext(const float * const * inputC
             }
         }
     } else {
-        auto const numInputChannelsToCopy{ std::min(totalNumInputChannels, mInputBuffer.size()) };
-
-        auto activeChannel{ std::begin(mAudioProcessor->getAudioData().config->sourcesAudioConfig) };
-        for (int i{}; i < numInputChannelsToCopy; ++i) {
-            source_index_t const sourceIndex{ activeChannel->key };
-            auto const * sourceData{ inputChannelData[sourceIndex.get() - source_index_t::OFFSET] };
-            auto * destinationData{ mInputBuffer[sourceIndex].getWritePointer(0) };
-            std::copy_n(sourceData, numSamples, destinationData);
-            ++activeChannel;
+        // The peaks are measured while copying, so that every input is only read once.
+        auto & sourcePeaks{ mAudioProcessor->acquireSourcePeaks() };
+        for (auto const & source : mAudioProcessor->getAudioData().config->sourcesAudioConfig) {
+            auto const channel{ source.key.get() - source_index_t::OFFSET };
+            if (channel >= totalNumInputChannels || inputChannelData[channel] == nullptr) {
+                // The device does not have this input : the source stays silent.
+                sourcePeaks[source.key] = 0.0f;
+                continue;
+            }
+            sourcePeaks[source.key] = kernels::copyAndGetPeak(inputChannelData[channel],
+                                                              inputBuffer[source.key].getWritePointer(0),
+                                                              numSamples);
         }
     }
 
     // do the actual processing
-    mAudioProcessor->processAudio(mInputBuffer, mOutputBuffer, mStereoOutputBuffer, mSampleRate);
+    mAudioProcessor->processAudio(inputBuffer, outputBuffer, stereoOutputBuffer, mSampleRate);
 
     // copy buffers to output
     if (mStereoRouting) {
-        jassert(mStereoOutputBuffer.getNumChannels() == 2);
+        jassert(stereoOutputBuffer.getNumChannels() == 2);
         auto const leftIndex{ mStereoRouting->left.template removeOffset<int>() };
         auto const rightIndex{ mStereoRouting->right.template removeOffset<int>() };
         if (leftIndex < totalNumOutputChannels) {
-            std::copy_n(mStereoOutputBuffer.getReadPointer(0), numSamples, outputChannelData[leftIndex]);
+            std::copy_n(stereoOutputBuffer.getReadPointer(0), numSamples, outputChannelData[leftIndex]);
         }
         if (rightIndex < totalNumOutputChannels) {
-            std::copy_n(mStereoOutputBuffer.getReadPointer(1), numSamples, outputChannelData[rightIndex]);
+            std::copy_n(stereoOutputBuffer.getReadPointer(1), numSamples, outputChannelData[rightIndex]);
         }
-    } else {
-        mOutputBuffer.copyToPhysicalOutput(outputChannelData, totalNumOutputChannels);
+    } else if (!isReferringToDevice) {
+        outputBuffer.copyToPhysicalOutput(outputChannelData, totalNumOutputChannels);
     }
 
     // Record
@@ -161,9 +277,19 @@ void AudioManager::audioDeviceIOCallbackWithContext(const float * const * inputC
                 "Recording stopped because samples were dropped.\nRecording on a faster disk might solve this issue.");
         };
 
-        for (auto const & recorder : mRecorders) {
-            jassert(recorder->audioFormatWriterPtr->getNumChannels() == recorder->dataToRecord.size());
-            auto const success{ recorder->threadedWriter->write(recorder->dataToRecord.data(), numSamples) };
+        for (auto * recorder : mRecorders) {
+            auto & dataToRecord{ recorder->dataToRecord };
+            dataToRecord.clearQuick();
+            for (auto const channel : recorder->stereoChannels) {
+                dataToRecord.add(stereoOutputBuffer.getReadPointer(channel));
+            }
+            for (auto const speaker : recorder->speakers) {
+                dataToRecord.add(bufferBank->hasSpeaker[speaker] ? outputBuffer[speaker].getReadPointer(0)
+                                                                 : mSilentBuffer.getReadPointer(0));
+            }
+
+            jassert(recorder->audioFormatWriterPtr->getNumChannels() == dataToRecord.size());
+            auto const success{ recorder->threadedWriter->write(dataToRecord.data(), numSamples) };
             if (!success) {
                 jassertfalse;
                 stopRecordingAndDisplayError();
@@ -171,6 +297,12 @@ void AudioManager::audioDeviceIOCallbackWithContext(const float * const * inputC
         }
         mNumSamplesRecorded += numSamples;
     }
+
+    auto const & silenceGate{ mAudioProcessor->getSilenceGate() };
+    mCallbackMonitor.setSourceActivity(silenceGate.getNumSources(),
+                                       silenceGate.getNumSkippedSources(),
+                                       silenceGate.getNumHeldSources());
+    mCallbackMonitor.endBlock(blockStart);
 }
 
 //==============================================================================
@@ -232,10 +364,12 @@ void AudioManager::init(juce::String const & deviceType,
                         juce::String const & outputDevice,
                         double const sampleRate,
                         int const bufferSize,
-                        tl::optional<StereoRouting> const & stereoRouting)
+                        tl::optional<StereoRouting> const & stereoRouting,
+                        bool const withSimulatedDevice)
 {
     JUCE_ASSERT_MESSAGE_THREAD;
-    mInstance.reset(new AudioManager{ deviceType, inputDevice, outputDevice, sampleRate, bufferSize, stereoRouting });
+    mInstance.reset(new AudioManager{
+        deviceType, inputDevice, outputDevice, sampleRate, bufferSize, stereoRouting, withSimulatedDevice });
 }
 
 //==============================================================================
@@ -360,6 +494,7 @@ bool AudioManager::prepareAudioPlayer(juce::File const & folder)
 
     juce::Thread::RealtimeOptions threadOptions;
     mPlayerThread.startRealtimeThread(threadOptions.withPriority(9));
+    mPlayerThread.addTimeSliceClient(&mPlayerThreadPlacement);
     reloadPlayerAudioFiles(currentAudioDevice->getCurrentBufferSizeSamples(),
                            currentAudioDevice->getCurrentSampleRate());
     return true;
@@ -522,7 +657,7 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
              juce::AudioFormat & format,
              double const sampleRate_,
              int const bufferSize_,
-             juce::Array<float const *> dataToRecord,
+             int const numChannels,
              juce::TimeSliceThread & timeSlicedThread) -> std::unique_ptr<FileRecorder> {
         juce::StringPairArray const metaData{}; // lets leave this empty for now
 
@@ -535,7 +670,7 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
         auto audioFormatWriter{ format.createWriterFor(outputStream,
                                                        juce::AudioFormatWriterOptions{}
                                                            .withSampleRate(sampleRate_)
-                                                           .withNumChannels(narrow<unsigned>(dataToRecord.size()))
+                                                           .withNumChannels(narrow<unsigned>(numChannels))
                                                            .withBitsPerSample(BITS_PER_SAMPLE)
                                                            .withQualityOptionIndex(RECORD_QUALITY)) };
         jassert(audioFormatWriter);
@@ -550,7 +685,7 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
         auto result{ std::make_unique<FileRecorder>() };
         result->audioFormatWriterPtr = audioFormatWriterPtr;
         result->threadedWriter = std::move(threadedWriter);
-        result->dataToRecord = std::move(dataToRecord);
+        result->dataToRecord.ensureStorageAllocated(numChannels);
         return result;
     };
 
@@ -623,38 +758,39 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
 
     auto const recordingBufferSize{ RECORDERS_BUFFER_SIZE_IN_SAMPLES * recordingParams.speakersToRecord.size() };
 
+    mSilentBuffer.setSize(1, SpeakerAudioBuffer::MAX_NUM_SAMPLES);
+    mSilentBuffer.clear();
+
     auto const makeInterleavedStereoRecorder = [&]() {
         jassert(filePaths.size() == 1);
-        jassert(mStereoOutputBuffer.getNumChannels() == 2);
-        juce::Array<float const *> dataToRecord{};
-        dataToRecord.add(mStereoOutputBuffer.getReadPointer(0));
-        dataToRecord.add(mStereoOutputBuffer.getReadPointer(1));
         auto recorder{ MAKE_RECORDING_INFO(filePaths[0],
                                            *audioFormat,
                                            recordingParams.sampleRate,
                                            recordingBufferSize,
-                                           std::move(dataToRecord),
+                                           2,
                                            mRecordersThread) };
         if (!recorder) {
             return false;
         }
+        recorder->stereoChannels.add(0);
+        recorder->stereoChannels.add(1);
         mRecorders.add(std::move(recorder));
         return true;
     };
 
     auto const makeSeparateStereoRecorder = [&]() {
         jassert(filePaths.size() == 2);
-        jassert(mStereoOutputBuffer.getNumChannels() == 2);
         for (int i{}; i < 2; ++i) {
             auto recorder{ MAKE_RECORDING_INFO(filePaths[i],
                                                *audioFormat,
                                                recordingParams.sampleRate,
                                                recordingBufferSize,
-                                               juce::Array<float const *>{ mStereoOutputBuffer.getReadPointer(i) },
+                                               1,
                                                mRecordersThread) };
             if (!recorder) {
                 return false;
             }
+            recorder->stereoChannels.add(i);
             mRecorders.add(std::move(recorder));
         }
         return true;
@@ -663,16 +799,16 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
     auto const makeInterleavedSpeakersRecorder = [&]() {
         jassert(filePaths.size() == 1);
         auto const & filePath{ filePaths[0] };
-        auto dataToRecord = mOutputBuffer.getArrayOfReadPointers(recordingParams.speakersToRecord);
         auto recordingInfo{ MAKE_RECORDING_INFO(filePath,
                                                 *audioFormat,
                                                 recordingParams.sampleRate,
                                                 recordingBufferSize,
-                                                std::move(dataToRecord),
+                                                recordingParams.speakersToRecord.size(),
                                                 mRecordersThread) };
         if (!recordingInfo) {
             return false;
         }
+        recordingInfo->speakers = recordingParams.speakersToRecord;
         mRecorders.add(std::move(recordingInfo));
         return true;
     };
@@ -682,17 +818,16 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
         for (int i{}; i < recordingParams.speakersToRecord.size(); ++i) {
             auto const outputPatch{ recordingParams.speakersToRecord[i] };
             auto const & filePath{ filePaths[i] };
-            juce::Array<float const *> dataToRecord{};
-            dataToRecord.add(mOutputBuffer[outputPatch].getReadPointer(0));
             auto recordingInfo{ MAKE_RECORDING_INFO(filePath,
                                                     *audioFormat,
                                                     recordingParams.sampleRate,
                                                     recordingBufferSize,
-                                                    std::move(dataToRecord),
+                                                    1,
                                                     mRecordersThread) };
             if (!recordingInfo) {
                 return false;
             }
+            recordingInfo->speakers.add(outputPatch);
             mRecorders.add(std::move(recordingInfo));
         }
         return true;
@@ -722,6 +857,7 @@ bool AudioManager::prepareToRecord(RecordingParameters const & recordingParams)
     }
 
     mRecordersThread.startThread(juce::Thread::Priority::highest);
+    mRecordersThread.addTimeSliceClient(&mRecordersThreadPlacement);
 
     return true;
 }
@@ -745,35 +881,6 @@ void AudioManager::stopRecording()
     mIsRecording = false;
 }
 
-//==============================================================================
-void AudioManager::initInputBuffer(juce::Array<source_index_t> const & sources)
-{
-    JUCE_ASSERT_MESSAGE_THREAD;
-    jassert(mAudioProcessor);
-    juce::ScopedLock const lock{ mAudioProcessor->getLock() };
-    mInputBuffer.init(sources);
-}
-
-//==============================================================================
-void AudioManager::initOutputBuffer(juce::Array<output_patch_t> const & speakers)
-{
-    JUCE_ASSERT_MESSAGE_THREAD;
-    jassert(mAudioProcessor);
-    juce::ScopedLock const lock{ mAudioProcessor->getLock() };
-    mOutputBuffer.init(speakers);
-}
-
-//==============================================================================
-void AudioManager::setBufferSize(int const newBufferSize)
-{
-    JUCE_ASSERT_MESSAGE_THREAD;
-    jassert(mAudioProcessor);
-    juce::ScopedLock const lock{ mAudioProcessor->getLock() };
-    mInputBuffer.setNumSamples(newBufferSize);
-    mOutputBuffer.setNumSamples(newBufferSize);
-    mStereoOutputBuffer.setSize(2, newBufferSize);
-}
-
 //==============================================================================
 void AudioManager::setStereoRouting(tl::optional<StereoRouting> const & stereoRouting)
 {
@@ -794,6 +901,7 @@ void AudioManager::audioDeviceAboutToStart(juce::AudioIODevice * device)
     // when AudioProcessor will be a real AudioSource, prepareToPlay() should be called here.
 
     mSampleRate = device->getCurrentSampleRate();
+    mCallbackMonitor.deviceAboutToStart();
 }
 
 //==============================================================================
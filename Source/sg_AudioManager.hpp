@@ -22,6 +22,8 @@
 #include "Containers/sg_TaggedAudioBuffer.hpp"
 #include "Data/sg_AudioStructs.hpp"
 #include "Data/sg_LogicStrucs.hpp"
+#include "sg_AudioCallbackMonitor.hpp"
+#include "sg_ThreadPlacement.hpp"
 
 #include <JuceHeader.h>
 
@@ -51,8 +53,13 @@ class AudioManager final : juce::AudioSourcePlayer
         // ThreadedWriter : this pointer is never actually used. This has been left in only for doing sanity checks
         // assertions.
         juce::AudioFormatWriter * audioFormatWriterPtr{};
-        // A collection of pointers to the buffers that will get recorded on disk. Note that this is NOT null terminated
-        // : all pointers are non-null and valid.
+        // The speakers recorded in this file. Empty when recording the stereo output.
+        juce::Array<output_patch_t> speakers{};
+        // The stereo channels recorded in this file (0 is left, 1 is right).
+        juce::Array<int> stereoChannels{};
+        // Pointers to the buffers that will get recorded on disk. Since the audio processor can switch buffers between
+        // two blocks, this is filled anew at every block. Its storage is allocated beforehand. Note that this is NOT
+        // null terminated : all pointers are non-null and valid.
         juce::Array<float const *> dataToRecord{};
     };
 
@@ -80,16 +87,15 @@ private:
     //==============================================================================
     AudioProcessor * mAudioProcessor{};
     juce::AudioDeviceManager mAudioDeviceManager{};
-    SourceAudioBuffer mInputBuffer{};
-    SpeakerAudioBuffer mOutputBuffer{};
-
-    juce::AudioBuffer<float> mStereoOutputBuffer{};
     tl::optional<StereoRouting> mStereoRouting{};
     // Recording
     bool mIsRecording{};
+    // Recorded in place of a speaker that was removed while recording.
+    juce::AudioBuffer<float> mSilentBuffer{};
     juce::Atomic<int64_t> mNumSamplesRecorded{};
     juce::OwnedArray<FileRecorder> mRecorders{};
     juce::TimeSliceThread mRecordersThread{ "SpatGRIS recording thread" };
+    threadPlacement::TimeSliceClient mRecordersThreadPlacement{ threadPlacement::Role::disk };
     // Playing
     juce::AudioFormatManager mFormatManager{};
     juce::Array<juce::File> mAudioFiles; // for audio thumbnails
@@ -97,10 +103,15 @@ private:
     juce::OwnedArray<juce::AudioTransportSource> mTransportSources{};
     juce::OwnedArray<source_index_t> mTransportSourcesIndexes{};
     juce::TimeSliceThread mPlayerThread{ "SpatGRIS player thread" };
+    threadPlacement::TimeSliceClient mPlayerThreadPlacement{ threadPlacement::Role::disk };
     juce::AudioFormat * mAudioFormat{};
     bool mFormatsRegistered{};
     std::atomic<bool> mIsPlaying{};
     std::atomic<bool> mIsPlayerLoading{};
+    // Statistics
+    AudioCallbackMonitor mCallbackMonitor{};
+    // The thread the audio role was last applied to, see sg_ThreadPlacement.hpp.
+    juce::Thread::ThreadID mAudioThreadId{};
     //==============================================================================
     static std::unique_ptr<AudioManager> mInstance;
 
@@ -136,10 +147,9 @@ public:
     juce::AudioFormatManager & getAudioFormatManager();
     juce::Array<juce::File> & getAudioFiles();
 
-    void initInputBuffer(juce::Array<source_index_t> const & sources);
-    void initOutputBuffer(juce::Array<output_patch_t> const & speakers);
-    void setBufferSize(int newBufferSize);
     void setStereoRouting(tl::optional<StereoRouting> const & stereoRouting);
+
+    [[nodiscard]] AudioCallbackMonitor & getCallbackMonitor() { return mCallbackMonitor; }
     //==============================================================================
     // AudioSourcePlayer overrides
     void audioDeviceError(const juce::String & errorMessage) override;
@@ -152,14 +162,18 @@ public:
     void audioDeviceAboutToStart(juce::AudioIODevice * device) override;
     void audioDeviceStopped() override;
     //==============================================================================
+    /** The simulated device of sg_SimulatedAudioDevice.hpp is only listed when asked for, so that a machine without a
+     * sound card never ends up on a silent device by default. */
     static void init(juce::String const & deviceType,
                      juce::String const & inputDevice,
                      juce::String const & outputDevice,
                      double sampleRate,
                      int bufferSize,
-                     tl::optional<StereoRouting> const & stereoRouting);
+                     tl::optional<StereoRouting> const & stereoRouting,
+                     bool withSimulatedDevice = false);
     static void free();
     [[nodiscard]] static AudioManager & getInstance();
+    [[nodiscard]] static bool isInitialized() noexcept { return mInstance != nullptr; }
 
 private:
     //==============================================================================
@@ -168,7 +182,8 @@ private:
                  juce::String const & outputDevice,
                  double sampleRate,
                  int bufferSize,
-                 tl::optional<StereoRouting> const & stereoRouting);
+                 tl::optional<StereoRouting> const & stereoRouting,
+                 bool withSimulatedDevice);
     //==============================================================================
     [[nodiscard]] bool tryInitAudioDevice(juce::String const & deviceType,
                                           juce::String const & inputDevice,
@@ -0,0 +1,201 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_StrongArray.hpp"
+#include "Data/sg_AudioStructs.hpp"
+#include "Data/sg_Macros.hpp"
+#include "Data/sg_constants.hpp"
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+
+namespace gris
+{
+/* The controls that the audio thread follows without a new AudioConfig : the
+   master gain, the speaker gains and the mute and solo states.
+
+   The message thread stores each of them in its own atomic, so that moving a
+   fader neither allocates nor locks. The audio thread reads them at every
+   block and ramps the speaker gains over RAMP_SECONDS to avoid zipper noise.
+   Muting or soloing a source fades it out or in over the same time : the
+   source is only left out of the spatialization once it is faded out.
+
+   A published AudioConfig still carries these values : setFromConfig() takes
+   them over and the config is then processed as if nothing was muted, so that
+   a config that was built before a mute cannot silence a source afterwards.
+*/
+class AudioParameters
+{
+public:
+    static constexpr double RAMP_SECONDS = 0.02;
+
+private:
+    //==============================================================================
+    // Message thread -> audio thread.
+    std::atomic<float> mMasterGain{ 1.0f };
+    std::atomic<bool> mIsStereoMuted{};
+    std::array<std::atomic<float>, MAX_NUM_SPEAKERS> mSpeakerGains{};
+    std::array<std::atomic<bool>, MAX_NUM_SPEAKERS> mIsSpeakerMuted{};
+    std::array<std::atomic<bool>, MAX_NUM_SOURCES> mIsSourceMuted{};
+    // Audio thread only.
+    double mSampleRate{};
+    StrongArray<output_patch_t, juce::SmoothedValue<float>, MAX_NUM_SPEAKERS> mSpeakerRamps{};
+    StrongArray<source_index_t, juce::SmoothedValue<float>, MAX_NUM_SOURCES> mSourceRamps{};
+    juce::SmoothedValue<float> mStereoRamp{};
+
+public:
+    //==============================================================================
+    AudioParameters() = default;
+    ~AudioParameters() = default;
+    SG_DELETE_COPY_AND_MOVE(AudioParameters)
+    //==============================================================================
+    void setMasterGain(float const gain) noexcept { mMasterGain.store(gain, std::memory_order_relaxed); }
+    void setStereoMuted(bool const isMuted) noexcept { mIsStereoMuted.store(isMuted, std::memory_order_relaxed); }
+    void setSpeakerGain(output_patch_t const speaker, float const gain) noexcept
+    {
+        mSpeakerGains[index(speaker)].store(gain, std::memory_order_relaxed);
+    }
+    void setSpeakerMuted(output_patch_t const speaker, bool const isMuted) noexcept
+    {
+        mIsSpeakerMuted[index(speaker)].store(isMuted, std::memory_order_relaxed);
+    }
+    void setSourceMuted(source_index_t const source, bool const isMuted) noexcept
+    {
+        mIsSourceMuted[index(source)].store(isMuted, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /* Message thread. Takes over the gains and mutes of a config that is about to be published. */
+    void setFromConfig(AudioConfig & config) noexcept
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+
+        setMasterGain(config.masterGain);
+        setStereoMuted(config.isStereoMuted);
+        config.isStereoMuted = false;
+
+        for (auto const & source : config.sourcesAudioConfig) {
+            setSourceMuted(source.key, source.value->isMuted);
+            source.value->isMuted = false;
+        }
+        for (auto const & speaker : config.speakersAudioConfig) {
+            setSpeakerGain(speaker.key, speaker.value->gain);
+            setSpeakerMuted(speaker.key, speaker.value->isMuted);
+            speaker.value->isMuted = false;
+        }
+    }
+
+    //==============================================================================
+    /* Audio thread. Must be called at the start of every block. */
+    void setSampleRate(double const sampleRate) noexcept
+    {
+        if (sampleRate == mSampleRate) {
+            return;
+        }
+        mSampleRate = sampleRate;
+        for (auto & ramp : mSpeakerRamps) {
+            ramp.reset(sampleRate, RAMP_SECONDS);
+        }
+        for (auto & ramp : mSourceRamps) {
+            ramp.reset(sampleRate, RAMP_SECONDS);
+        }
+        mStereoRamp.reset(sampleRate, RAMP_SECONDS);
+    }
+
+    /* Audio thread. Reads the source mutes once per block, so that applySourceMuteRamp() and isSourceFadedOut() agree
+       for the whole block. Returns true if a source is faded in or out during the block. */
+    [[nodiscard]] bool updateSourceMuteRamps() noexcept
+    {
+        auto isFading{ false };
+        for (source_index_t source{ source_index_t::OFFSET }; index(source) < mIsSourceMuted.size(); ++source) {
+            auto & ramp{ mSourceRamps[source] };
+            ramp.setTargetValue(mIsSourceMuted[index(source)].load(std::memory_order_relaxed) ? 0.0f : 1.0f);
+            isFading = isFading || ramp.isSmoothing();
+        }
+        return isFading;
+    }
+
+    /* Audio thread. Fades the source's samples while it is being muted or unmuted. Returns 0 once the source is faded
+       out, in which case the samples are left untouched, and 1 otherwise. */
+    [[nodiscard]] float applySourceMuteRamp(source_index_t const source, float * samples, int const numSamples) noexcept
+    {
+        auto & ramp{ mSourceRamps[source] };
+        if (!ramp.isSmoothing()) {
+            return ramp.getTargetValue();
+        }
+        ramp.applyGain(samples, numSamples);
+        return 1.0f;
+    }
+
+    /* Audio thread. True once a muted source is faded out : it can be left out entirely. */
+    [[nodiscard]] bool isSourceFadedOut(source_index_t const source) const noexcept
+    {
+        auto const & ramp{ mSourceRamps[source] };
+        return !ramp.isSmoothing() && ramp.getTargetValue() < SMALL_GAIN;
+    }
+
+    /* Audio thread. Returns the gain that is left to apply to the speaker's samples. While the gain is ramping, the
+       ramp is applied to the samples and 1 is returned. */
+    [[nodiscard]] float
+        applySpeakerGainRamp(output_patch_t const speaker, float * samples, int const numSamples) noexcept
+    {
+        auto const isMuted{ mIsSpeakerMuted[index(speaker)].load(std::memory_order_relaxed) };
+        auto const gain{ mMasterGain.load(std::memory_order_relaxed)
+                         * mSpeakerGains[index(speaker)].load(std::memory_order_relaxed) };
+        return applyRamp(mSpeakerRamps[speaker], isMuted ? 0.0f : gain, samples, numSamples);
+    }
+
+    /* Audio thread. Same as applySpeakerGainRamp(), for both channels of the stereo reduction. */
+    [[nodiscard]] float applyStereoGainRamp(juce::AudioBuffer<float> & stereoBuffer, int const numSamples) noexcept
+    {
+        auto const isMuted{ mIsStereoMuted.load(std::memory_order_relaxed) };
+        mStereoRamp.setTargetValue(isMuted ? 0.0f : mMasterGain.load(std::memory_order_relaxed));
+        if (!mStereoRamp.isSmoothing()) {
+            return mStereoRamp.getTargetValue();
+        }
+        mStereoRamp.applyGain(stereoBuffer, numSamples);
+        return 1.0f;
+    }
+
+private:
+    //==============================================================================
+    template<typename Index>
+    [[nodiscard]] static std::size_t index(Index const index) noexcept
+    {
+        return static_cast<std::size_t>(index.template removeOffset<int>());
+    }
+
+    [[nodiscard]] static float
+        applyRamp(juce::SmoothedValue<float> & ramp, float const target, float * samples, int const numSamples) noexcept
+    {
+        ramp.setTargetValue(target);
+        if (!ramp.isSmoothing()) {
+            return ramp.getTargetValue();
+        }
+        ramp.applyGain(samples, numSamples);
+        return 1.0f;
+    }
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(AudioParameters)
+};
+} // namespace gris
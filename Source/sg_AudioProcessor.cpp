@@ -24,10 +24,13 @@
 #include "Containers/sg_TaggedAudioBuffer.hpp"
 #include "Data/sg_Narrow.hpp"
 #include "Data/sg_constants.hpp"
+#include "sg_AudioKernels.hpp"
 #include "sg_AudioManager.hpp"
 #include "sg_MainComponent.hpp"
 
 #include <array>
+#include <cmath>
+#include <utility>
 
 namespace gris
 {
@@ -42,30 +45,244 @@ AudioProcessor::AudioProcessor()
 void AudioProcessor::setAudioConfig(std::unique_ptr<AudioConfig> newAudioConfig)
 {
     JUCE_ASSERT_MESSAGE_THREAD;
-    juce::ScopedLock const lock{ mLock };
+    jassert(newAudioConfig);
 
-    if (!mAudioData.config || !mAudioData.config->sourcesAudioConfig.hasSameKeys(newAudioConfig->sourcesAudioConfig)) {
-        AudioManager::getInstance().initInputBuffer(newAudioConfig->sourcesAudioConfig.getKeys());
+    // A config that was not adopted yet is replaced by the new one.
+    std::unique_ptr<ConfigHandoff> const unclaimed{ mPendingHandoff.exchange(nullptr, std::memory_order_acq_rel) };
+    if (unclaimed) {
+        if (unclaimed->spatAlgorithm) {
+            // The new config has to carry the algorithm instead.
+            mIsSpatAlgorithmPublished = false;
+            mInFlightSpatAlgorithm = nullptr;
+        }
+    } else {
+        // The audio thread adopted the last published config : it is now working with its bank.
+        mAdoptedBankIndex = mPublishedBankIndex;
+    }
+    collectRetired();
+
+    mParameters.setFromConfig(*newAudioConfig);
+
+    auto handoff{ std::make_unique<ConfigHandoff>() };
+    handoff->bankIndex = prepareBufferBank(*newAudioConfig);
+    handoff->plan = ExecutionPlan::make(*newAudioConfig);
+    handoff->config = std::move(newAudioConfig);
+    if (!mIsSpatAlgorithmPublished) {
+        handoff->spatAlgorithm = mSpatAlgorithm.get();
+        handoff->numFadeBlocks = mFadeLength;
+        mInFlightSpatAlgorithm = handoff->spatAlgorithm;
+        mIsSpatAlgorithmPublished = true;
+        mSpatAlgorithmSources = handoff->config->sourcesAudioConfig.getKeys();
+        mSpatAlgorithmSpeakers = handoff->config->speakersAudioConfig.getKeys();
+        mIsSpatAlgorithmStereo = handoff->config->isStereo;
+    }
+
+    mPublishedBankIndex = handoff->bankIndex;
+    mPendingHandoff.store(handoff.release(), std::memory_order_release);
+}
+
+//==============================================================================
+bool AudioProcessor::fitsSpatAlgorithm(AudioConfig const & config) const
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    return mSpatAlgorithm && mIsSpatAlgorithmPublished && config.isStereo == mIsSpatAlgorithmStereo
+           && config.sourcesAudioConfig.getKeys() == mSpatAlgorithmSources
+           && config.speakersAudioConfig.getKeys() == mSpatAlgorithmSpeakers;
+}
+
+//==============================================================================
+void AudioProcessor::setBufferSize(int const newBufferSize)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    mBufferSize = newBufferSize;
+}
+
+//==============================================================================
+void AudioProcessor::setSpatAlgorithm(std::unique_ptr<AbstractSpatAlgorithm> newSpatAlgorithm)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    jassert(newSpatAlgorithm);
+
+    if (mSpatAlgorithm) {
+        mRetiredSpatAlgorithms.add(mSpatAlgorithm.release());
+    }
+    mSpatAlgorithm = std::move(newSpatAlgorithm);
+    mIsSpatAlgorithmPublished = false;
+
+    collectRetired();
+}
+
+//==============================================================================
+void AudioProcessor::setSpatAlgorithmFadeLength(int const numBlocks)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    jassert(numBlocks >= 0);
+    mFadeLength = numBlocks;
+}
+
+//==============================================================================
+void AudioProcessor::collectRetired()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    auto * retired{ mRetiredHandoffs.exchange(nullptr, std::memory_order_acq_rel) };
+    while (retired) {
+        std::unique_ptr<ConfigHandoff> const handoff{ retired };
+        retired = handoff->nextRetired;
+        if (handoff->spatAlgorithm != nullptr && handoff->spatAlgorithm == mInFlightSpatAlgorithm) {
+            // The audio thread switched to it.
+            mInFlightSpatAlgorithm = nullptr;
+        }
+    }
+
+    collectRetiredSpatAlgorithms();
+}
+
+//==============================================================================
+void AudioProcessor::collectRetiredSpatAlgorithms()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    // The audio thread publishes the outgoing algorithm before the new one, so reading them in the opposite order never
+    // misses an algorithm that is still in use.
+    auto const * const activeSpatAlgorithm{ mActiveSpatAlgorithm.load() };
+    auto const * const fadingSpatAlgorithm{ mFadingSpatAlgorithm.load() };
+
+    for (auto i{ mRetiredSpatAlgorithms.size() - 1 }; i >= 0; --i) {
+        auto const * const spatAlgorithm{ mRetiredSpatAlgorithms.getUnchecked(i) };
+        if (spatAlgorithm != activeSpatAlgorithm && spatAlgorithm != fadingSpatAlgorithm
+            && spatAlgorithm != mInFlightSpatAlgorithm) {
+            mRetiredSpatAlgorithms.remove(i);
+        }
+    }
+}
+
+//==============================================================================
+int AudioProcessor::prepareBufferBank(AudioConfig const & config)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    auto const sources{ config.sourcesAudioConfig.getKeys() };
+    auto const speakers{ config.speakersAudioConfig.getKeys() };
+
+    auto const hasLayout = [&](BufferBank const & bank) {
+        return bank.numSamples == mBufferSize && bank.sources == sources && bank.speakers == speakers;
+    };
+
+    // The bank used by the audio thread can be shared with the new config, but it cannot be modified.
+    if (hasLayout(mBufferBanks[static_cast<size_t>(mAdoptedBankIndex)])) {
+        return mAdoptedBankIndex;
+    }
+
+    auto const freeBankIndex{ 1 - mAdoptedBankIndex };
+    auto & bank{ mBufferBanks[static_cast<size_t>(freeBankIndex)] };
+    if (hasLayout(bank)) {
+        return freeBankIndex;
+    }
+
+    bank.inputBuffer.init(sources);
+    bank.outputBuffer.init(speakers);
+    bank.inputBuffer.setNumSamples(mBufferSize);
+    bank.outputBuffer.setNumSamples(mBufferSize);
+    bank.stereoBuffer.setSize(2, mBufferSize);
+    bank.fadeOutputBuffer.init(speakers);
+    bank.fadeOutputBuffer.setNumSamples(mBufferSize);
+    bank.fadeStereoBuffer.setSize(2, mBufferSize);
+    bank.fadeGains.setSize(2, mBufferSize);
+
+    // Referring to other memory frees the memory a buffer owns. This is done here so that it never happens on the
+    // audio thread.
+    bank.deviceInputBuffer.init(sources);
+    bank.deviceOutputBuffer.init(speakers);
+    bank.deviceInputBuffer.setNumSamples(mBufferSize);
+    bank.deviceOutputBuffer.setNumSamples(mBufferSize);
+    for (auto const channel : bank.deviceInputBuffer) {
+        auto * const data{ bank.inputBuffer[channel.key].getWritePointer(0) };
+        channel.value->setDataToReferTo(&data, 1, mBufferSize);
+    }
+    for (auto const channel : bank.deviceOutputBuffer) {
+        auto * const data{ bank.outputBuffer[channel.key].getWritePointer(0) };
+        channel.value->setDataToReferTo(&data, 1, mBufferSize);
+    }
+
+    for (auto const speaker : bank.speakers) {
+        bank.hasSpeaker[speaker] = false;
     }
-    if (!mAudioData.config
-        || !mAudioData.config->speakersAudioConfig.hasSameKeys(newAudioConfig->speakersAudioConfig)) {
-        AudioManager::getInstance().initOutputBuffer(newAudioConfig->speakersAudioConfig.getKeys());
+    for (auto const speaker : speakers) {
+        bank.hasSpeaker[speaker] = true;
     }
 
-    mAudioData.config = std::move(newAudioConfig);
+    bank.sources = sources;
+    bank.speakers = speakers;
+    bank.numSamples = mBufferSize;
+
+    return freeBankIndex;
+}
+
+//==============================================================================
+void AudioProcessor::adoptPendingConfig() noexcept
+{
+    mAreSourcesFading = mParameters.updateSourceMuteRamps();
+
+    auto * handoff{ mPendingHandoff.exchange(nullptr, std::memory_order_acq_rel) };
+    if (!handoff) {
+        return;
+    }
+
+    auto const isSameLayout{ handoff->bankIndex == mActiveBankIndex };
+    if (handoff->spatAlgorithm) {
+        // The outgoing algorithm can keep rendering with the new config only if the sources and speakers are the same.
+        auto * const previousSpatAlgorithm{ mActiveSpatAlgorithm.load() };
+        auto const shouldFade{ previousSpatAlgorithm != nullptr && isSameLayout && handoff->numFadeBlocks > 0 };
+        // Published before the new one, see collectRetiredSpatAlgorithms().
+        mFadingSpatAlgorithm.store(shouldFade ? previousSpatAlgorithm : nullptr);
+        mActiveSpatAlgorithm.store(handoff->spatAlgorithm);
+        mFadeBlock = 0;
+        mNumFadeBlocks = handoff->numFadeBlocks;
+    } else if (!isSameLayout) {
+        mFadingSpatAlgorithm.store(nullptr);
+    }
 
+    std::swap(mAudioData.config, handoff->config);
+    std::swap(mPlan, handoff->plan);
+    mActiveBankIndex = handoff->bankIndex;
     std::fill(mAudioData.state.sourcesAudioState.begin(), mAudioData.state.sourcesAudioState.end(), SourceAudioState{});
+
+    // Only the message thread takes from the stack, and it takes everything at once, so this cannot suffer from ABA.
+    auto * head{ mRetiredHandoffs.load(std::memory_order_relaxed) };
+    do {
+        handoff->nextRetired = head;
+    } while (!mRetiredHandoffs.compare_exchange_weak(head,
+                                                     handoff,
+                                                     std::memory_order_release,
+                                                     std::memory_order_relaxed));
+}
+
+//==============================================================================
+AudioProcessor::BufferBank * AudioProcessor::getActiveBufferBank() noexcept
+{
+    if (!mAudioData.config) {
+        return nullptr;
+    }
+    return &mBufferBanks[static_cast<size_t>(mActiveBankIndex)];
+}
+
+//==============================================================================
+SourcePeaks & AudioProcessor::acquireSourcePeaks() noexcept
+{
+    jassert(mSourcePeaksTicket == nullptr);
+    mSourcePeaksTicket = mAudioData.sourcePeaksUpdater.acquire();
+    return mSourcePeaksTicket->get();
 }
 
 //==============================================================================
 void AudioProcessor::processInputPeaks(SourceAudioBuffer & inputBuffer, SourcePeaks & peaks) const noexcept
 {
-    for (auto const channel : inputBuffer) {
-        auto const & config{ mAudioData.config->sourcesAudioConfig[channel.key] };
-        auto const & buffer{ *channel.value };
-        auto const peak{ config.isMuted ? 0.0f : buffer.getMagnitude(0, inputBuffer.getNumSamples()) };
+    auto const numSamples{ inputBuffer.getNumSamples() };
 
-        peaks[channel.key] = peak;
+    for (auto const source : mPlan->sources) {
+        peaks[source] = inputBuffer[source].getMagnitude(0, numSamples);
     }
 }
 
@@ -74,31 +291,102 @@ void AudioProcessor::processOutputModifiersAndPeaks(SpeakerAudioBuffer & speaker
 {
     auto const numSamples{ speakersBuffer.getNumSamples() };
 
-    for (auto const channel : speakersBuffer) {
-        auto const & config{ mAudioData.config->speakersAudioConfig[channel.key] };
-        auto & buffer{ *channel.value };
-        auto const gain{ mAudioData.config->masterGain * config.gain };
-        if (config.isMuted || gain < SMALL_GAIN) {
+    for (auto const & step : mPlan->gainSteps) {
+        auto & buffer{ speakersBuffer[step.speaker] };
+        auto * const samples{ buffer.getWritePointer(0) };
+        auto const gain{ mParameters.applySpeakerGainRamp(step.speaker, samples, numSamples) };
+        if (gain < SMALL_GAIN) {
             buffer.clear();
-            peaks[channel.key] = 0.0f;
+            peaks[step.speaker] = 0.0f;
             continue;
         }
+        peaks[step.speaker] = kernels::applyGainAndGetPeak(samples, numSamples, gain);
+    }
 
-        buffer.applyGain(0, numSamples, gain);
-
-        if (config.highpassConfig) {
-            auto * const samples{ buffer.getWritePointer(0) };
-            auto const & highpassConfig{ *config.highpassConfig };
-            auto & highpassVars{ mAudioData.state.speakersAudioState[channel.key].highpassState };
-            if (highpassConfig.isNewConfig) {
-                highpassVars.resetValues();
-                highpassConfig.isNewConfig = false;
-            }
-            highpassConfig.process(samples, numSamples, highpassVars, mRandomNoise);
+    for (auto const & step : mPlan->highpassSteps) {
+        auto & buffer{ speakersBuffer[step.speaker] };
+        auto * const samples{ buffer.getWritePointer(0) };
+        auto const gain{ mParameters.applySpeakerGainRamp(step.speaker, samples, numSamples) };
+        if (gain < SMALL_GAIN) {
+            buffer.clear();
+            peaks[step.speaker] = 0.0f;
+            continue;
         }
+        auto const & highpassConfig{ *step.highpassConfig };
+        auto & highpassVars{ mAudioData.state.speakersAudioState[step.speaker].highpassState };
+        if (highpassConfig.isNewConfig) {
+            highpassVars.resetValues();
+            highpassConfig.isNewConfig = false;
+        }
+        peaks[step.speaker] = kernels::applyGainHighpassAndGetPeak(samples,
+                                                                   numSamples,
+                                                                   gain,
+                                                                   highpassConfig,
+                                                                   highpassVars,
+                                                                   mRandomNoise);
+    }
+
+    if (mPlan->highpassBank) {
+        mPlan->highpassBank->process(mParameters,
+                                     speakersBuffer,
+                                     mAudioData.state.speakersAudioState,
+                                     peaks,
+                                     mRandomNoise);
+    }
+}
+
+//==============================================================================
+void AudioProcessor::processSpatAlgorithms(SourceAudioBuffer & sourceBuffer,
+                                           SpeakerAudioBuffer & speakerBuffer,
+                                           juce::AudioBuffer<float> & stereoBuffer,
+                                           SourcePeaks const & sourcePeaks) noexcept
+{
+    auto * const spatAlgorithm{ mActiveSpatAlgorithm.load(std::memory_order_relaxed) };
+    if (!spatAlgorithm) {
+        jassertfalse;
+        return;
+    }
+    spatAlgorithm->process(*mAudioData.config, sourceBuffer, speakerBuffer, stereoBuffer, sourcePeaks, nullptr);
+
+    auto * const fadingSpatAlgorithm{ mFadingSpatAlgorithm.load(std::memory_order_relaxed) };
+    if (!fadingSpatAlgorithm) {
+        return;
+    }
+
+    auto & bank{ mBufferBanks[static_cast<size_t>(mActiveBankIndex)] };
+    auto const numSamples{ speakerBuffer.getNumSamples() };
+    bank.fadeOutputBuffer.silence();
+    bank.fadeStereoBuffer.clear();
+    fadingSpatAlgorithm->process(*mAudioData.config,
+                                 sourceBuffer,
+                                 bank.fadeOutputBuffer,
+                                 bank.fadeStereoBuffer,
+                                 sourcePeaks,
+                                 nullptr);
+
+    // Equal-power crossfade, so that the loudness does not dip halfway when the two renders are uncorrelated.
+    auto * const newGains{ bank.fadeGains.getWritePointer(0) };
+    auto * const oldGains{ bank.fadeGains.getWritePointer(1) };
+    auto const fadeStart{ static_cast<float>(mFadeBlock * numSamples) };
+    auto const fadeLength{ static_cast<float>(mNumFadeBlocks * numSamples) };
+    for (int i{}; i < numSamples; ++i) {
+        auto const angle{ (fadeStart + static_cast<float>(i + 1)) / fadeLength * juce::MathConstants<float>::halfPi };
+        newGains[i] = std::sin(angle);
+        oldGains[i] = std::cos(angle);
+    }
+    auto const crossfade = [&](float * newSamples, float const * oldSamples) {
+        juce::FloatVectorOperations::multiply(newSamples, newGains, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(newSamples, oldSamples, oldGains, numSamples);
+    };
+    for (auto const speaker : mPlan->speakers) {
+        crossfade(speakerBuffer[speaker].getWritePointer(0), bank.fadeOutputBuffer[speaker].getReadPointer(0));
+    }
+    for (int channel{}; channel < 2; ++channel) {
+        crossfade(stereoBuffer.getWritePointer(channel), bank.fadeStereoBuffer.getReadPointer(channel));
+    }
 
-        auto const magnitude{ buffer.getMagnitude(0, numSamples) };
-        peaks[channel.key] = magnitude;
+    if (++mFadeBlock >= mNumFadeBlocks) {
+        mFadingSpatAlgorithm.store(nullptr);
     }
 }
 
@@ -108,11 +396,11 @@ void AudioProcessor::processAudio(SourceAudioBuffer & sourceBuffer,
                                   juce::AudioBuffer<float> & stereoBuffer,
                                   double sampleRate) noexcept NONBLOCKING
 {
-    // Skip if the user is editing the speaker setup.
-    juce::ScopedTryLock const lock{ mLock };
-    if (!lock.isLocked()) {
-        return;
-    }
+    jassert(mAudioData.config && mPlan);
+
+    // The gain ramps of the spatialization algorithms and the stereo reductions get no anti-denormal noise, unlike
+    // the highpass filters, and decay towards denormals when the sources stop.
+    juce::ScopedNoDenormals const noDenormals{};
 
     if (mPulsedNoiseParams.sampleRate != sampleRate && mAudioData.config->pinkNoisePulsed) {
         mPulsedNoiseParams.sampleRate = sampleRate;
@@ -122,19 +410,30 @@ void AudioProcessor::processAudio(SourceAudioBuffer & sourceBuffer,
 
     jassert(sourceBuffer.getNumSamples() == speakerBuffer.getNumSamples());
     auto const numSamples{ sourceBuffer.getNumSamples() };
+    mParameters.setSampleRate(sampleRate);
 
-    // Process source peaks
-    auto * sourcePeaksTicket{ mAudioData.sourcePeaksUpdater.acquire() };
+    // Process source peaks, unless they were measured while filling the input buffer
+    auto * sourcePeaksTicket{ std::exchange(mSourcePeaksTicket, nullptr) };
+    if (!sourcePeaksTicket) {
+        sourcePeaksTicket = mAudioData.sourcePeaksUpdater.acquire();
+        processInputPeaks(sourceBuffer, sourcePeaksTicket->get());
+    }
     auto & sourcePeaks{ sourcePeaksTicket->get() };
-    processInputPeaks(sourceBuffer, sourcePeaks);
+    // Fade the sources that were just muted or unmuted, and leave out the ones that are faded out
+    for (auto const source : mPlan->sources) {
+        auto & buffer{ sourceBuffer[source] };
+        if (mParameters.applySourceMuteRamp(source, buffer.getWritePointer(0), numSamples) < SMALL_GAIN) {
+            sourcePeaks[source] = 0.0f;
+        }
+    }
 
     if (mAudioData.config->pinkNoiseGain) {
+        mSilenceGate.clearCounts();
+        // There is nothing to crossfade.
+        mFadingSpatAlgorithm.store(nullptr);
+
         // Process pink noise
-        StaticVector<output_patch_t, MAX_NUM_SPEAKERS> activeChannels{};
-        for (auto const & channel : mAudioData.config->speakersAudioConfig) {
-            activeChannels.push_back(channel.key);
-        }
-        auto data{ speakerBuffer.getArrayOfWritePointers(activeChannels) };
+        auto data{ speakerBuffer.getArrayOfWritePointers(mPlan->speakers) };
         fillWithPinkNoise(data.data(),
                           numSamples,
                           narrow<int>(data.size()),
@@ -142,11 +441,17 @@ void AudioProcessor::processAudio(SourceAudioBuffer & sourceBuffer,
                           mAudioData.config->pinkNoisePulsed,
                           mPulsedNoiseParams);
     } else {
-        // Process spat algorithm
-        mSpatAlgorithm->process(*mAudioData.config, sourceBuffer, speakerBuffer, stereoBuffer, sourcePeaks, nullptr);
+        // Process spat algorithm, leaving out the quiet sources once their tail is over
+        auto const & gatedSourcePeaks{
+            mSilenceGate.process(*mAudioData.config, mParameters, sourcePeaks, numSamples, sampleRate)
+        };
+        processSpatAlgorithms(sourceBuffer, speakerBuffer, stereoBuffer, gatedSourcePeaks);
 
         // Process direct outs
         for (auto const & directOutPair : mAudioData.config->directOutPairs) {
+            if (mParameters.isSourceFadedOut(directOutPair.first)) {
+                continue;
+            }
             auto const & origin{ sourceBuffer[directOutPair.first] };
             auto & dest{ speakerBuffer[directOutPair.second] };
             dest.addFrom(0, 0, origin, 0, 0, numSamples);
@@ -157,12 +462,12 @@ void AudioProcessor::processAudio(SourceAudioBuffer & sourceBuffer,
     mAudioData.sourcePeaksUpdater.setMostRecent(sourcePeaksTicket);
 
     if (mAudioData.config->isStereo) {
-        if (mAudioData.config->isStereoMuted) {
+        auto const stereoGain{ mParameters.applyStereoGainRamp(stereoBuffer, numSamples) };
+        if (stereoGain < SMALL_GAIN) {
             stereoBuffer.applyGain(0.0f);
         } else {
-            auto const & masterGain{ mAudioData.config->masterGain };
-            if (!juce::approximatelyEqual(masterGain, 0.0f)) {
-                stereoBuffer.applyGain(masterGain);
+            if (!juce::approximatelyEqual(stereoGain, 1.0f)) {
+                stereoBuffer.applyGain(stereoGain);
             }
             auto * stereoPeaksTicket{ mAudioData.stereoPeaksUpdater.acquire() };
             auto & stereoPeaks{ stereoPeaksTicket->get() };
@@ -182,7 +487,17 @@ void AudioProcessor::processAudio(SourceAudioBuffer & sourceBuffer,
 //==============================================================================
 AudioProcessor::~AudioProcessor()
 {
-    if (auto const audioDevice{ AudioManager::getInstance().getAudioDeviceManager().getCurrentAudioDevice() })
-        audioDevice->close();
+    // Offline renders do not use an AudioManager.
+    if (AudioManager::isInitialized()) {
+        if (auto const audioDevice{ AudioManager::getInstance().getAudioDeviceManager().getCurrentAudioDevice() })
+            audioDevice->close();
+    }
+
+    delete mPendingHandoff.exchange(nullptr);
+    auto * retired{ mRetiredHandoffs.exchange(nullptr) };
+    while (retired) {
+        std::unique_ptr<ConfigHandoff> const handoff{ retired };
+        retired = handoff->nextRetired;
+    }
 }
 } // namespace gris
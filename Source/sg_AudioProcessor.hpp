@@ -19,12 +19,20 @@
 
 #pragma once
 
+#include "Containers/sg_AtomicUpdater.hpp"
+#include "Containers/sg_StrongArray.hpp"
 #include "Containers/sg_TaggedAudioBuffer.hpp"
 #include "Data/sg_AudioStructs.hpp"
 #include "sg_AbstractSpatAlgorithm.hpp"
+#include "sg_AudioParameters.hpp"
+#include "sg_ExecutionPlan.hpp"
 #include "sg_PinkNoiseGenerator.hpp"
+#include "sg_SilenceGate.hpp"
 #include <JuceHeader.h>
 
+#include <array>
+#include <atomic>
+
 namespace gris
 {
 class SpeakerModel;
@@ -33,35 +41,160 @@ class SpeakerModel;
 /** Holds the spatialization algorithm instance and does most of the audio processing. */
 class AudioProcessor
 {
+public:
+    //==============================================================================
+    /** The buffers used by the audio callback, laid out for a given set of sources, speakers and buffer size.
+     *
+     * There are two banks : while the audio thread works with one of them, the message thread can lay out the other one
+     * for an upcoming config without ever touching memory that is being processed. */
+    struct BufferBank {
+        SourceAudioBuffer inputBuffer{};
+        SpeakerAudioBuffer outputBuffer{};
+        juce::AudioBuffer<float> stereoBuffer{};
+        // Same layout, but without memory of their own : the audio thread points them to the device buffers when the
+        // routing allows it. See AudioManager::audioDeviceIOCallbackWithContext().
+        SourceAudioBuffer deviceInputBuffer{};
+        SpeakerAudioBuffer deviceOutputBuffer{};
+        // Where the outgoing spatialization algorithm renders while it is crossfaded with the new one. The two channels
+        // of fadeGains hold the gains of the new and of the outgoing algorithm for the current block.
+        SpeakerAudioBuffer fadeOutputBuffer{};
+        juce::AudioBuffer<float> fadeStereoBuffer{};
+        juce::AudioBuffer<float> fadeGains{};
+        // The layout the buffers currently have. Only used by the message thread.
+        juce::Array<source_index_t> sources{};
+        juce::Array<output_patch_t> speakers{};
+        int numSamples{ -1 };
+        // Lets the audio thread check in constant time that a speaker exists in this bank.
+        StrongArray<output_patch_t, bool, MAX_NUM_SPEAKERS> hasSpeaker{};
+    };
+
+private:
+    //==============================================================================
+    /** A config published by the message thread, along with the bank that was laid out for it.
+     *
+     * Once the audio thread adopts it, the same object is used to send the previous config back to the message thread
+     * so that it gets freed there. */
+    struct ConfigHandoff {
+        std::unique_ptr<AudioConfig> config{};
+        std::unique_ptr<ExecutionPlan> plan{};
+        int bankIndex{};
+        // The spatialization algorithm to switch to along with the config, or nullptr to keep the current one. It is
+        // owned by the message thread.
+        AbstractSpatAlgorithm * spatAlgorithm{};
+        int numFadeBlocks{};
+        // Links the retired handoffs that the message thread has not collected yet.
+        ConfigHandoff * nextRetired{};
+    };
+    //==============================================================================
     AudioData mAudioData{};
+    AudioParameters mParameters{};
     juce::CriticalSection mLock{};
-    std::unique_ptr<AbstractSpatAlgorithm> mSpatAlgorithm{};
     juce::Random mRandomNoise{};
     PulsedNoiseParams mPulsedNoiseParams{};
+    std::array<BufferBank, 2> mBufferBanks{};
+    // Message thread -> audio thread. Only ever holds a single config : publishing a new one takes back the one that
+    // was not adopted yet.
+    std::atomic<ConfigHandoff *> mPendingHandoff{};
+    // Audio thread -> message thread. A stack that the audio thread pushes to and that the message thread empties at
+    // once, so that retiring a config never has to wait for the message thread.
+    std::atomic<ConfigHandoff *> mRetiredHandoffs{};
+    // Written by the audio thread. The message thread reads them to know which algorithms are still in use.
+    std::atomic<AbstractSpatAlgorithm *> mActiveSpatAlgorithm{};
+    std::atomic<AbstractSpatAlgorithm *> mFadingSpatAlgorithm{};
+    // Audio thread only.
+    int mFadeBlock{};
+    int mNumFadeBlocks{};
+    int mActiveBankIndex{};
+    std::unique_ptr<ExecutionPlan> mPlan{};
+    // The source peaks of the coming block, when they are measured before processAudio() is called.
+    AtomicUpdater<SourcePeaks>::Token * mSourcePeaksTicket{};
+    SilenceGate mSilenceGate{};
+    // Set by adoptPendingConfig(), see areSourcesFading().
+    bool mAreSourcesFading{};
+    // Message thread only.
+    int mAdoptedBankIndex{};
+    int mPublishedBankIndex{};
+    int mBufferSize{};
+    int mFadeLength{ DEFAULT_NUM_FADE_BLOCKS };
+    // The algorithm that the message thread talks to. The audio thread switches to it with the next config.
+    std::unique_ptr<AbstractSpatAlgorithm> mSpatAlgorithm{};
+    bool mIsSpatAlgorithmPublished{ true };
+    // The algorithm carried by a handoff that has not come back yet.
+    AbstractSpatAlgorithm * mInFlightSpatAlgorithm{};
+    // The layout of the config that mSpatAlgorithm was published with, see fitsSpatAlgorithm().
+    juce::Array<source_index_t> mSpatAlgorithmSources{};
+    juce::Array<output_patch_t> mSpatAlgorithmSpeakers{};
+    bool mIsSpatAlgorithmStereo{};
+    // Replaced algorithms, freed once the audio thread is done with them.
+    juce::OwnedArray<AbstractSpatAlgorithm> mRetiredSpatAlgorithms{};
 
 public:
+    static constexpr int DEFAULT_NUM_FADE_BLOCKS = 8;
     //==============================================================================
     AudioProcessor();
     ~AudioProcessor();
     SG_DELETE_COPY_AND_MOVE(AudioProcessor)
     //==============================================================================
+    /** Publishes a new config. The audio thread starts using it on its next block : this never blocks the audio thread
+     * and never makes it skip a block.
+     *
+     * Only needed for structural changes : gains and mutes can be changed on their own with getParameters(). */
     void setAudioConfig(std::unique_ptr<AudioConfig> newAudioConfig);
+    /** Message thread. True if the config has the sources, the speakers and the stereo output of the one the current
+     * algorithm was published with : it can then be published without a new algorithm. */
+    [[nodiscard]] bool fitsSpatAlgorithm(AudioConfig const & config) const;
+    /** The buffers will be resized on the next call to setAudioConfig(). */
+    void setBufferSize(int newBufferSize);
+    /** Replaces the spatialization algorithm. The audio thread switches to it along with the next config published by
+     * setAudioConfig(), so the algorithm and the config always match. It never waits for the audio thread. */
+    void setSpatAlgorithm(std::unique_ptr<AbstractSpatAlgorithm> newSpatAlgorithm);
+    /** The number of blocks over which the previous algorithm is crossfaded with a new one. 0 switches at once. The
+     * crossfade only happens when the sources and the speakers stay the same. */
+    void setSpatAlgorithmFadeLength(int numBlocks);
+    /** Message thread. Frees what the audio thread is done with. Called regularly, since an algorithm that is being
+     * faded out is only released after the fade. */
+    void collectRetired();
+    /** Must be called by the audio thread at the start of every block, before using the buffers or the config. */
+    void adoptPendingConfig() noexcept;
+    /** Audio thread. True when sources are being muted or unmuted during the current block : processAudio() then fades
+     * them in the source buffer, which must not be the device's own inputs. */
+    [[nodiscard]] bool areSourcesFading() const noexcept { return mAreSourcesFading; }
+    /** Returns the buffers that match the config in use by the audio thread, or nullptr if there is no config yet. */
+    [[nodiscard]] BufferBank * getActiveBufferBank() noexcept;
+    /** Lets the audio thread measure the source peaks while it fills the input buffer. The next call to processAudio()
+     * publishes them instead of measuring them again, so every source has to be written to. */
+    [[nodiscard]] SourcePeaks & acquireSourcePeaks() noexcept;
+    /** Only guards structural changes such as the recorders or the audio device. */
     [[nodiscard]] juce::CriticalSection const & getLock() const noexcept { return mLock; }
     void processAudio(SourceAudioBuffer & sourceBuffer,
                       SpeakerAudioBuffer & speakerBuffer,
                       juce::AudioBuffer<float> & stereoBuffer,
                       double sampleRate) noexcept;
 
+    /** Audio thread. Lets the audio callback report what the silence gate did during the last block. */
+    [[nodiscard]] SilenceGate const & getSilenceGate() const noexcept { return mSilenceGate; }
+    /** Any thread. How long the quiet sources stay open, see SilenceGate::getHoldSecondsFor(). */
+    void setSilenceHoldSeconds(double const holdSeconds) noexcept { mSilenceGate.setHoldSeconds(holdSeconds); }
+
+    /** Message thread. Lets gains and mutes change without publishing a new config. */
+    [[nodiscard]] AudioParameters & getParameters() noexcept { return mParameters; }
+
     auto & getAudioData() { return mAudioData; }
     auto const & getAudioData() const { return mAudioData; }
 
-    auto const & getSpatAlgorithm() const { return mSpatAlgorithm; }
-    auto & getSpatAlgorithm() { return mSpatAlgorithm; }
+    /** Message thread. The most recent algorithm, even if the audio thread has not switched to it yet. */
+    [[nodiscard]] AbstractSpatAlgorithm * getSpatAlgorithm() const noexcept { return mSpatAlgorithm.get(); }
 
 private:
     //==============================================================================
     void processInputPeaks(SourceAudioBuffer & inputBuffer, SourcePeaks & peaks) const noexcept;
     void processOutputModifiersAndPeaks(SpeakerAudioBuffer & speakersBuffer, SpeakerPeaks & peaks) noexcept;
+    [[nodiscard]] int prepareBufferBank(AudioConfig const & config);
+    void collectRetiredSpatAlgorithms();
+    void processSpatAlgorithms(SourceAudioBuffer & sourceBuffer,
+                               SpeakerAudioBuffer & speakerBuffer,
+                               juce::AudioBuffer<float> & stereoBuffer,
+                               SourcePeaks const & sourcePeaks) noexcept;
     //==============================================================================
     JUCE_LEAK_DETECTOR(AudioProcessor)
 };
@@ -0,0 +1,41 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_BenchmarkRunner.hpp"
+
+#include <iostream>
+
+//==============================================================================
+// The main() routine of SpatGRISBench, see SpatGRISBench.jucer.
+int main(int argc, char * argv[])
+{
+    // The calling thread becomes the message thread, which loads the binaural profiles.
+    juce::ScopedJuceInitialiser_GUI const juceInitialiser{};
+
+    juce::ArgumentList const arguments{ argc, argv };
+    juce::String error{};
+    auto const options{ gris::BenchmarkRunner::parseOptions(arguments, error) };
+    if (!options) {
+        std::cerr << "Error: " << error << '\n' << gris::BenchmarkRunner::getUsage() << std::endl;
+        return 1;
+    }
+
+    gris::BenchmarkRunner runner{ *options };
+    return runner.run();
+}
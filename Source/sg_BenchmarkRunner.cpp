@@ -0,0 +1,431 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_BenchmarkRunner.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+#if JUCE_LINUX
+    #include <unistd.h>
+#endif
+
+namespace gris
+{
+//==============================================================================
+juce::String BenchmarkRunner::getUsage()
+{
+    return "Usage: SpatGRISBench [--layouts=ring,dome,cube] [--modes=Dome,Cube,Hybrid]\n"
+           "                     [--speakers=8,64,512] [--sources=1,16,256] [--buffer-sizes=64,512,2048]\n"
+           "                     [--stereo=<mode>,...] [--blocks=<count>] [--multicore] [--output=<file>]\n"
+           "       SpatGRISBench --kernels [--layouts=...] [--speakers=...] [--buffer-sizes=...]\n"
+           "Stereo modes: "
+           + STEREO_MODE_STRINGS.joinIntoString(", ") + ".";
+}
+
+//==============================================================================
+tl::optional<BenchmarkRunner::Options> BenchmarkRunner::parseOptions(juce::ArgumentList const & arguments,
+                                                                     juce::String & error)
+{
+    auto const getList = [&](char const * const option) {
+        return juce::StringArray::fromTokens(arguments.getValueForOption(option).unquoted(), ",", {});
+    };
+    auto const getInts = [&](char const * const option, int const max, juce::Array<int> & values) {
+        if (!arguments.containsOption(option)) {
+            return true;
+        }
+        values.clear();
+        for (auto const & token : getList(option)) {
+            auto const value{ token.getIntValue() };
+            if (!token.containsOnly("0123456789") || value < 1 || value > max) {
+                error = juce::String{ option } + " values must be between 1 and " + juce::String{ max } + ".";
+                return false;
+            }
+            values.add(value);
+        }
+        if (values.isEmpty()) {
+            error = juce::String{ option } + " needs at least one value.";
+            return false;
+        }
+        return true;
+    };
+
+    Options result{};
+    result.multicore = arguments.containsOption("--multicore");
+    result.kernels = arguments.containsOption("--kernels");
+    if (result.kernels) {
+        result.numBlocks = kernelBenchmark::DEFAULT_NUM_BLOCKS;
+    }
+    if (arguments.containsOption("--output")) {
+        result.output
+            = juce::File::getCurrentWorkingDirectory().getChildFile(arguments.getValueForOption("--output"));
+    }
+
+    if (!getInts("--speakers", MAX_NUM_SPEAKERS, result.numSpeakers)
+        || !getInts("--sources", MAX_NUM_SOURCES, result.numSources)
+        || !getInts("--buffer-sizes", SourceAudioBuffer::MAX_NUM_SAMPLES, result.bufferSizes)) {
+        return tl::nullopt;
+    }
+
+    if (arguments.containsOption("--blocks")) {
+        result.numBlocks = arguments.getValueForOption("--blocks").getIntValue();
+        if (result.numBlocks < 1) {
+            error = "--blocks must be at least 1.";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--layouts")) {
+        result.layouts.clear();
+        for (auto const & token : getList("--layouts")) {
+            std::size_t index{};
+            while (index < LAYOUT_NAMES.size() && token != LAYOUT_NAMES[index]) {
+                ++index;
+            }
+            if (index == LAYOUT_NAMES.size()) {
+                error = "Unknown layout \"" + token + "\".";
+                return tl::nullopt;
+            }
+            result.layouts.add(static_cast<Layout>(index));
+        }
+    }
+
+    if (arguments.containsOption("--modes")) {
+        result.spatModes.clear();
+        for (auto const & token : getList("--modes")) {
+            auto found{ false };
+            for (auto const spatMode : { SpatMode::vbap, SpatMode::mbap, SpatMode::hybrid }) {
+                if (token.equalsIgnoreCase(juce::String{ spatModeToString(spatMode) })) {
+                    result.spatModes.add(spatMode);
+                    found = true;
+                }
+            }
+            if (!found) {
+                error = "Unknown spatialization mode \"" + token + "\".";
+                return tl::nullopt;
+            }
+        }
+    }
+
+    if (arguments.containsOption("--stereo")) {
+        for (auto const & token : getList("--stereo")) {
+            auto const index{ STEREO_MODE_STRINGS.indexOf(token, true) };
+            if (index < 0) {
+                error = "Unknown stereo mode \"" + token + "\".";
+                return tl::nullopt;
+            }
+            result.stereoModes.add(stringToStereoMode(STEREO_MODE_STRINGS[index]));
+        }
+    }
+
+    return result;
+}
+
+//==============================================================================
+int BenchmarkRunner::run()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    juce::Array<juce::var> results{};
+    for (auto const layout : mOptions.layouts) {
+        if (mOptions.kernels) {
+            for (auto const numSpeakers : mOptions.numSpeakers) {
+                for (auto const bufferSize : mOptions.bufferSizes) {
+                    results.add(runKernels(layout, numSpeakers, bufferSize));
+                }
+            }
+            continue;
+        }
+        for (auto const spatMode : mOptions.spatModes) {
+            for (auto const numSpeakers : mOptions.numSpeakers) {
+                for (auto const numSources : mOptions.numSources) {
+                    for (auto const bufferSize : mOptions.bufferSizes) {
+                        for (auto const & stereoMode : mOptions.stereoModes) {
+                            results.add(
+                                runOne(layout, spatMode, numSpeakers, numSources, bufferSize, stereoMode));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto * report{ new juce::DynamicObject{} };
+    report->setProperty("version", juce::String{ ProjectInfo::versionString });
+    report->setProperty("cpu", juce::SystemStats::getCpuModel());
+    report->setProperty("numCpus", juce::SystemStats::getNumCpus());
+    report->setProperty("multicore", mOptions.multicore);
+    report->setProperty("kernels", mOptions.kernels);
+    report->setProperty("blocks", mOptions.numBlocks);
+    report->setProperty("sampleRate", SAMPLE_RATE);
+    report->setProperty("results", results);
+    auto const json{ juce::JSON::toString(juce::var{ report }) };
+
+    if (mOptions.output == juce::File{}) {
+        std::cout << json << std::endl;
+        return 0;
+    }
+    if (!mOptions.output.replaceWithText(json)) {
+        std::cerr << "Error: unable to write \"" << mOptions.output.getFullPathName() << "\"." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+//==============================================================================
+juce::var BenchmarkRunner::runOne(Layout const layout,
+                                  SpatMode const spatMode,
+                                  int const numSpeakers,
+                                  int const numSources,
+                                  int const bufferSize,
+                                  tl::optional<StereoMode> const & stereoMode) const
+{
+    auto * result{ new juce::DynamicObject{} };
+    result->setProperty("layout", LAYOUT_NAMES[static_cast<std::size_t>(layout)]);
+    result->setProperty("spatMode", juce::String{ spatModeToString(spatMode) });
+    result->setProperty("stereoMode", stereoMode ? juce::var{ getStereoModeName(*stereoMode) } : juce::var{});
+    result->setProperty("speakers", numSpeakers);
+    result->setProperty("sources", numSources);
+    result->setProperty("bufferSize", bufferSize);
+    juce::var const resultVar{ result };
+
+    juce::String const description{ juce::String{ LAYOUT_NAMES[static_cast<std::size_t>(layout)] } + " "
+                                    + juce::String{ spatModeToString(spatMode) } + " "
+                                    + (stereoMode ? getStereoModeName(*stereoMode) : juce::String{ "-" }) + ", "
+                                    + juce::String{ numSpeakers } + " speakers, " + juce::String{ numSources }
+                                    + " sources, " + juce::String{ bufferSize } + " samples" };
+    std::cerr << description << std::endl;
+
+    auto const data{ makeData(layout, spatMode, numSpeakers, numSources, bufferSize, stereoMode) };
+    if (!data) {
+        result->setProperty("error", "Unable to make the setup.");
+        return resultVar;
+    }
+
+    auto const residentBefore{ readResidentKilobytes() };
+    auto const buildStart{ juce::Time::getHighResolutionTicks() };
+    multicoreTuning::applyPreset(data->project.multicoreDSPPreset);
+    auto spatAlgorithm{ session::makeSpatAlgorithm(*data, mOptions.multicore) };
+    auto const buildEnd{ juce::Time::getHighResolutionTicks() };
+    auto const residentAfter{ readResidentKilobytes() };
+
+    if (auto const spatError{ spatAlgorithm->getError() }) {
+        result->setProperty("error", session::spatAlgorithmErrorToString(*spatError));
+        return resultVar;
+    }
+    if (stereoMode == StereoMode::hrtf && !waitForBinauralProfile(*spatAlgorithm)) {
+        result->setProperty("error", "Unable to load the binaural profile.");
+        return resultVar;
+    }
+
+    auto const timing{ rendererBenchmark::measure(*spatAlgorithm, *data, mOptions.numBlocks) };
+    result->setProperty("buildMs", juce::Time::highResolutionTicksToSeconds(buildEnd - buildStart) * 1000.0);
+    result->setProperty("nsPerSample", timing.nsPerSample);
+    result->setProperty("nsPerUpdate", timing.nsPerUpdate);
+    if (numSources > 1) {
+        auto const numSilentSources{ numSources / 2 };
+        auto const skipped{
+            rendererBenchmark::measure(*spatAlgorithm, *data, mOptions.numBlocks, numSilentSources, 0.0f)
+        };
+        auto const held{
+            rendererBenchmark::measure(*spatAlgorithm, *data, mOptions.numBlocks, numSilentSources, SMALL_GAIN)
+        };
+        result->setProperty("halfSilentSkippedNsPerSample", skipped.nsPerSample);
+        result->setProperty("halfSilentHeldNsPerSample", held.nsPerSample);
+    }
+    result->setProperty("rssGrowthKB",
+                        residentBefore && residentAfter ? juce::var{ *residentAfter - *residentBefore }
+                                                        : juce::var{});
+    return resultVar;
+}
+
+//==============================================================================
+juce::var BenchmarkRunner::runKernels(Layout const layout, int const numSpeakers, int const bufferSize) const
+{
+    auto * result{ new juce::DynamicObject{} };
+    result->setProperty("layout", LAYOUT_NAMES[static_cast<std::size_t>(layout)]);
+    result->setProperty("speakers", numSpeakers);
+    result->setProperty("bufferSize", bufferSize);
+    juce::var const resultVar{ result };
+
+    std::cerr << "kernels " << LAYOUT_NAMES[static_cast<std::size_t>(layout)] << ", " << numSpeakers
+              << " speakers, " << bufferSize << " samples" << std::endl;
+
+    auto const data{ makeData(layout, SpatMode::vbap, numSpeakers, 1, bufferSize, tl::nullopt, true) };
+    if (!data) {
+        result->setProperty("error", "Unable to make the setup.");
+        return resultVar;
+    }
+
+    auto const config{ data->toAudioConfig() };
+    auto const timing{ kernelBenchmark::measure(*config, bufferSize, mOptions.numBlocks) };
+    result->setProperty("threePassNsPerSample", timing.threePassNsPerSample);
+    result->setProperty("fusedNsPerSample", timing.fusedNsPerSample);
+    result->setProperty("maxDifference", timing.maxDifference);
+
+    auto const bankTiming{
+        kernelBenchmark::measureHighpassBank(*config, bufferSize, SAMPLE_RATE, mOptions.numBlocks)
+    };
+    result->setProperty("bankedSpeakers", bankTiming.numBankedSpeakers);
+    result->setProperty("scalarHighpassNsPerSample", bankTiming.scalarNsPerSample);
+    result->setProperty("bankNsPerSample", bankTiming.bankNsPerSample);
+    result->setProperty("bankMaxDifference", bankTiming.maxDifference);
+    return resultVar;
+}
+
+//==============================================================================
+std::unique_ptr<SpatGrisData> BenchmarkRunner::makeData(Layout const layout,
+                                                        SpatMode const spatMode,
+                                                        int const numSpeakers,
+                                                        int const numSources,
+                                                        int const bufferSize,
+                                                        tl::optional<StereoMode> const & stereoMode,
+                                                        bool const withHighpass)
+{
+    auto const version{ SPAT_GRIS_VERSION.toString() };
+    juce::String const setupSpatMode{ spatModeToString(spatMode == SpatMode::mbap ? SpatMode::mbap
+                                                                                  : SpatMode::vbap) };
+
+    juce::XmlElement speakerSetupXml{ SpeakerSetup::XmlTags::MAIN_TAG };
+    speakerSetupXml.setAttribute(SpeakerSetup::XmlTags::VERSION, version);
+    speakerSetupXml.setAttribute("SPAT_MODE", setupSpatMode);
+    speakerSetupXml.setAttribute("DIFFUSION", 0.0);
+    speakerSetupXml.setAttribute("GENERAL_MUTE", 0);
+    for (int i{}; i < numSpeakers; ++i) {
+        auto const position{ makeSpeakerPosition(layout, i, numSpeakers) };
+        auto * speaker{ speakerSetupXml.createNewChildElement("SPEAKER_" + juce::String{ i + 1 }) };
+        speaker->setAttribute("STATE", "normal");
+        speaker->setAttribute("GAIN", 0.0);
+        speaker->setAttribute("DIRECT_OUT_ONLY", 0);
+        auto * positionXml{ speaker->createNewChildElement("POSITION") };
+        positionXml->setAttribute("X", position.x);
+        positionXml->setAttribute("Y", position.y);
+        positionXml->setAttribute("Z", position.z);
+        if (withHighpass && i % 2 == 0) {
+            speaker->createNewChildElement("HIGHPASS")->setAttribute("FREQ", KERNELS_HIGHPASS_FREQUENCY);
+        }
+    }
+
+    juce::XmlElement projectXml{ ProjectData::XmlTags::MAIN_TAG };
+    projectXml.setAttribute(ProjectData::XmlTags::VERSION, version);
+    projectXml.setAttribute("MASTER_GAIN", 0.0);
+    projectXml.setAttribute("GAIN_INTERPOLATION", 0.0);
+    projectXml.setAttribute("SPAT_MODE", juce::String{ spatModeToString(spatMode) });
+    auto * sources{ projectXml.createNewChildElement("SOURCES") };
+    for (int i{}; i < numSources; ++i) {
+        auto const hybridSpatMode{ spatMode == SpatMode::hybrid && i % 2 == 1 ? SpatMode::mbap : SpatMode::vbap };
+        auto * source{ sources->createNewChildElement("SOURCE_" + juce::String{ i + 1 }) };
+        source->setAttribute("STATE", "normal");
+        source->setAttribute("COLOR", static_cast<int>(juce::Colours::red.getARGB()));
+        source->setAttribute("HYBRID_SPAT_MODE", juce::String{ spatModeToString(hybridSpatMode) });
+    }
+    auto * mbapSettings{ projectXml.createNewChildElement("MBAP_SETTINGS") };
+    mbapSettings->setAttribute("FREQ", 16000.0);
+    mbapSettings->setAttribute("ATTENUATION", 0.0);
+    mbapSettings->setAttribute("BYPASS", "off");
+
+    auto speakerSetup{ SpeakerSetup::fromXml(speakerSetupXml) };
+    auto project{ ProjectData::fromXml(projectXml) };
+    if (!speakerSetup || !project) {
+        return nullptr;
+    }
+
+    auto data{ std::make_unique<SpatGrisData>() };
+    data->speakerSetup = std::move(*speakerSetup);
+    data->project = std::move(*project);
+    data->appData.audioSettings.sampleRate = SAMPLE_RATE;
+    data->appData.audioSettings.bufferSize = bufferSize;
+    data->appData.stereoMode = stereoMode;
+    data->appData.binauralSettings.useDefaultBinauralProfile = true;
+    session::reconcileSpatModes(*data);
+    return data;
+}
+
+//==============================================================================
+CartesianVector BenchmarkRunner::makeSpeakerPosition(Layout const layout, int const index, int const count)
+{
+    auto const fraction{ (static_cast<float>(index) + 0.5f) / static_cast<float>(count) };
+    switch (layout) {
+    case Layout::ring: {
+        auto const azimuth{ juce::MathConstants<float>::twoPi * fraction };
+        return CartesianVector{ std::sin(azimuth), std::cos(azimuth), 0.0f };
+    }
+    case Layout::dome: {
+        // A Fibonacci spiral over the upper half of the sphere : every speaker covers the same area.
+        static auto const GOLDEN_ANGLE{ juce::MathConstants<float>::pi * (3.0f - std::sqrt(5.0f)) };
+        auto const z{ 1.0f - fraction };
+        auto const radius{ std::sqrt(1.0f - z * z) };
+        auto const azimuth{ GOLDEN_ANGLE * static_cast<float>(index) };
+        return CartesianVector{ radius * std::sin(azimuth), radius * std::cos(azimuth), z };
+    }
+    case Layout::cube: {
+        auto const side{ static_cast<int>(std::ceil(std::cbrt(static_cast<float>(count)))) };
+        auto const toCoordinate = [side](int const step) {
+            return side == 1 ? 0.0f : static_cast<float>(step) / static_cast<float>(side - 1);
+        };
+        return CartesianVector{ toCoordinate(index % side) * 2.0f - 1.0f,
+                                toCoordinate(index / side % side) * 2.0f - 1.0f,
+                                toCoordinate(index / (side * side)) };
+    }
+    }
+    jassertfalse;
+    return CartesianVector{ 0.0f, 1.0f, 0.0f };
+}
+
+//==============================================================================
+juce::String BenchmarkRunner::getStereoModeName(StereoMode const stereoMode)
+{
+    for (auto const & name : STEREO_MODE_STRINGS) {
+        if (stringToStereoMode(name) == stereoMode) {
+            return name;
+        }
+    }
+    jassertfalse;
+    return {};
+}
+
+//==============================================================================
+bool BenchmarkRunner::waitForBinauralProfile(AbstractSpatAlgorithm & spatAlgorithm)
+{
+    static constexpr juce::uint32 SOFA_TIMEOUT_MS = 60000;
+
+    auto const state{ std::make_shared<std::atomic<int>>(-1) };
+    spatAlgorithm.setCallback([state](int const newState) { state->store(newState); });
+    auto const startTime{ juce::Time::getMillisecondCounter() };
+    while (state->load() < 0 && juce::Time::getMillisecondCounter() - startTime < SOFA_TIMEOUT_MS) {
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(50);
+    }
+    // Like the offline renderer, keep going if the profile is still loading.
+    return state->load() != 1;
+}
+
+//==============================================================================
+tl::optional<juce::int64> BenchmarkRunner::readResidentKilobytes()
+{
+#if JUCE_LINUX
+    // The second field is the resident set, in pages.
+    auto const fields{ juce::StringArray::fromTokens(juce::File{ "/proc/self/statm" }.loadFileAsString(), false) };
+    if (fields.size() > 1) {
+        return fields[1].getLargeIntValue() * static_cast<juce::int64>(sysconf(_SC_PAGESIZE)) / 1024;
+    }
+#endif
+    return tl::nullopt;
+}
+} // namespace gris
@@ -0,0 +1,133 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_LogicStrucs.hpp"
+#include "Data/sg_Macros.hpp"
+#include "Data/sg_constants.hpp"
+#include "sg_KernelBenchmark.hpp"
+#include "sg_RendererBenchmark.hpp"
+#include "sg_SessionUtilities.hpp"
+
+#include <JuceHeader.h>
+
+#include <array>
+
+namespace gris
+{
+/* Times the spatialization algorithms over synthetic setups, without an audio
+   device and without the GUI. Built as SpatGRISBench, a console application of
+   its own (SpatGRISBench.jucer and sg_BenchMain.cpp) :
+
+     SpatGRISBench [--layouts=ring,dome,cube] [--modes=Dome,Cube,Hybrid]
+                   [--speakers=8,64,512] [--sources=1,16,256]
+                   [--buffer-sizes=64,512,2048] [--stereo=<mode>,...]
+                   [--blocks=<count>] [--multicore] [--output=<file.json>]
+     SpatGRISBench --kernels [--layouts=...] [--speakers=...] [--buffer-sizes=...]
+
+   Every combination of the lists is built and timed with rendererBenchmark :
+   rings are on the horizon, domes are spread over the upper half of the unit
+   sphere and cubes fill the field layer by layer. Hybrid setups send half of
+   their sources to the dome and half to the cube. Every stereo mode listed is
+   timed on top of the setups without a stereo reduction.
+
+   Setups with more than one source are timed twice more with half of their
+   sources silent : once left out, the way SilenceGate hands them over, and
+   once held open at SMALL_GAIN, the way it renders them while an HRTF tail
+   rings out. The difference is the work the gate saves once the hold ends.
+
+   --kernels times the speaker output stage instead, with kernelBenchmark :
+   every other speaker of each setup gets a highpass filter, so that both the
+   gain-only and the filtered paths are compared with the former three passes.
+
+   The results are written as JSON, to the standard output unless --output is
+   given, so that two runs can be compared. Progress goes to the standard
+   error. The memory column is how much the resident set grew while the
+   algorithm was built : it is only available on Linux, and only an estimate
+   since freed memory may be reused.
+*/
+class BenchmarkRunner
+{
+public:
+    //==============================================================================
+    enum class Layout { ring, dome, cube };
+    static constexpr std::array<char const *, 3> LAYOUT_NAMES{ "ring", "dome", "cube" };
+
+    struct Options {
+        juce::Array<Layout> layouts{ Layout::ring, Layout::dome, Layout::cube };
+        juce::Array<SpatMode> spatModes{ SpatMode::vbap, SpatMode::mbap, SpatMode::hybrid };
+        juce::Array<int> numSpeakers{ 8, 64, 512 };
+        juce::Array<int> numSources{ 1, 16, 256 };
+        juce::Array<int> bufferSizes{ 64, 512, 2048 };
+        juce::Array<tl::optional<StereoMode>> stereoModes{ tl::nullopt };
+        int numBlocks{ rendererBenchmark::DEFAULT_NUM_BLOCKS };
+        bool multicore{};
+        bool kernels{};
+        juce::File output{};
+    };
+
+private:
+    static constexpr double SAMPLE_RATE = 48000.0;
+    static constexpr float KERNELS_HIGHPASS_FREQUENCY = 80.0f;
+
+    //==============================================================================
+    Options mOptions{};
+
+public:
+    //==============================================================================
+    explicit BenchmarkRunner(Options options) : mOptions(std::move(options)) {}
+    BenchmarkRunner() = delete;
+    ~BenchmarkRunner() = default;
+    SG_DELETE_COPY_AND_MOVE(BenchmarkRunner)
+    //==============================================================================
+    [[nodiscard]] static juce::String getUsage();
+    [[nodiscard]] static tl::optional<Options> parseOptions(juce::ArgumentList const & arguments,
+                                                            juce::String & error);
+    /* Returns the process exit code. Runs on the message thread, which it only gives back while waiting for the
+       binaural profile to be loaded. */
+    [[nodiscard]] int run();
+
+private:
+    //==============================================================================
+    [[nodiscard]] juce::var runOne(Layout const layout,
+                                   SpatMode const spatMode,
+                                   int const numSpeakers,
+                                   int const numSources,
+                                   int const bufferSize,
+                                   tl::optional<StereoMode> const & stereoMode) const;
+    [[nodiscard]] juce::var runKernels(Layout const layout, int const numSpeakers, int const bufferSize) const;
+    /* The setups are written like the files they are usually read from. */
+    [[nodiscard]] static std::unique_ptr<SpatGrisData> makeData(Layout const layout,
+                                                                SpatMode const spatMode,
+                                                                int const numSpeakers,
+                                                                int const numSources,
+                                                                int const bufferSize,
+                                                                tl::optional<StereoMode> const & stereoMode,
+                                                                bool const withHighpass = false);
+    /* Angles are clockwise from the front, like everywhere else. */
+    [[nodiscard]] static CartesianVector makeSpeakerPosition(Layout const layout, int const index, int const count);
+    [[nodiscard]] static juce::String getStereoModeName(StereoMode const stereoMode);
+    [[nodiscard]] static bool waitForBinauralProfile(AbstractSpatAlgorithm & spatAlgorithm);
+    [[nodiscard]] static tl::optional<juce::int64> readResidentKilobytes();
+
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(BenchmarkRunner)
+};
+} // namespace gris
@@ -141,6 +141,12 @@ SpatSettingsSubPanel::SpatSettingsSubPanel(ControlPanel & controlPanel,
                "Experimental : This will use more CPU resources but can perform better on large speaker setups. Does "
                "not parallelize stereo or binaural reductions.",
                NOT_A_RADIO_BUTTON_ID);
+    initButton(mMulticoreDSPAutoToggle,
+               "Auto",
+               "Uses the fastest of the single core and the multicore DSP, with both presets, as timed on this "
+               "machine. Enabling it calibrates the current setup if it never was. Use the Calibrate button of the "
+               "settings window after changing the setup.",
+               NOT_A_RADIO_BUTTON_ID);
     initButton(mMulticoreDSPCPUPresetToggle,
                "A",
                "This preset uses less idle CPU but can perform worse.",
@@ -200,9 +206,11 @@ SpatSettingsSubPanel::SpatSettingsSubPanel(ControlPanel & controlPanel,
         .withTopPadding(COL_2_TOP_PADDING);
     mStereoRoutingLayout.addSection(mRightCombo).withFixedSize(COL_2_QUARTER_WIDTH + COL_2_SPACER);
 
+    static constexpr auto COL_2_SIXTH_WIDTH = COL_2_HALF_WIDTH / 3;
     mMulticoreLayout.addSection(mMulticoreDSPToggle).withFixedSize(COL_2_HALF_WIDTH);
-    mMulticoreLayout.addSection(mMulticoreDSPCPUPresetToggle).withFixedSize(COL_2_QUARTER_WIDTH);
-    mMulticoreLayout.addSection(mMulticoreDSPLatencyPresetToggle).withFixedSize(COL_2_QUARTER_WIDTH);
+    mMulticoreLayout.addSection(mMulticoreDSPAutoToggle).withFixedSize(COL_2_SIXTH_WIDTH);
+    mMulticoreLayout.addSection(mMulticoreDSPCPUPresetToggle).withFixedSize(COL_2_SIXTH_WIDTH);
+    mMulticoreLayout.addSection(mMulticoreDSPLatencyPresetToggle).withFixedSize(COL_2_SIXTH_WIDTH);
 
     mCol2Layout.addSection(mAttenuationSettingsButton).withFixedSize(LABEL_HEIGHT);
     mCol2Layout.addSection(mAttenuationLayout).withFixedSize(ROW_1_CONTENT_HEIGHT).withBottomPadding(ROW_PADDING);
@@ -336,6 +344,17 @@ void SpatSettingsSubPanel::setMulticoreDSPPreset(int preset)
     JUCE_ASSERT_MESSAGE_THREAD;
 }
 
+//==============================================================================
+void SpatSettingsSubPanel::setMulticoreDSPAutoTuning(bool autoTuning)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    mMulticoreDSPAutoToggle.setToggleState(autoTuning, juce::dontSendNotification);
+    // The tuning overrides them.
+    mMulticoreDSPToggle.setEnabled(!autoTuning);
+    mMulticoreDSPCPUPresetToggle.setEnabled(!autoTuning);
+    mMulticoreDSPLatencyPresetToggle.setEnabled(!autoTuning);
+}
+
 //==============================================================================
 void SpatSettingsSubPanel::setStereoMode(tl::optional<StereoMode> const & stereoMode)
 {
@@ -480,6 +499,9 @@ void SpatSettingsSubPanel::buttonClicked(juce::Button * button)
         mControlPanel.forceLayoutUpdate();
     } else if (button == &mMulticoreDSPToggle) {
         mMainContentComponent.setMulticoreDSPState(button->getToggleState());
+    } else if (button == &mMulticoreDSPAutoToggle) {
+        setMulticoreDSPAutoTuning(button->getToggleState());
+        mMainContentComponent.setMulticoreDSPAutoTuning(button->getToggleState());
     } else if (button == &mMulticoreDSPCPUPresetToggle && button->getToggleState()) {
         mMainContentComponent.setMulticoreDSPPreset(OPTIMIZE_CPU_MULTICORE_PRESET);
     } else if (button == &mMulticoreDSPLatencyPresetToggle && button->getToggleState()) {
@@ -567,6 +589,11 @@ void ControlPanel::setMulticoreDSPPreset(int preset)
     JUCE_ASSERT_MESSAGE_THREAD;
     mSpatSettingsSubPanel.setMulticoreDSPPreset(preset);
 }
+void ControlPanel::setMulticoreDSPAutoTuning(bool autoTuning)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    mSpatSettingsSubPanel.setMulticoreDSPAutoTuning(autoTuning);
+}
 
 //==============================================================================
 void ControlPanel::setStereoMode(tl::optional<StereoMode> const & mode)
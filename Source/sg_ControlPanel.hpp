@@ -110,6 +110,7 @@ class SpatSettingsSubPanel final
 
     juce::ComboBox mStereoReductionCombo{};
     juce::TextButton mMulticoreDSPToggle{};
+    juce::TextButton mMulticoreDSPAutoToggle{};
     juce::TextButton mMulticoreDSPCPUPresetToggle{};
     juce::TextButton mMulticoreDSPLatencyPresetToggle{};
     /**
@@ -139,6 +140,7 @@ public:
     void setSpatMode(SpatMode spatMode);
     void setMulticoreDSP(bool useMulticoreDSP);
     void setMulticoreDSPPreset(int preset);
+    void setMulticoreDSPAutoTuning(bool autoTuning);
     void setStereoMode(tl::optional<StereoMode> const & stereoMode);
     void setAttenuationDb(dbfs_t attenuation);
     void setAttenuationHz(hz_t freq);
@@ -194,6 +196,7 @@ public:
     void setSpatMode(SpatMode spatMode);
     void setMulticoreDSP(bool useMulticoreDSP);
     void setMulticoreDSPPreset(int preset);
+    void setMulticoreDSPAutoTuning(bool autoTuning);
     void setStereoMode(tl::optional<StereoMode> const & mode);
     void setCubeAttenuationDb(dbfs_t value);
     void setCubeAttenuationHz(hz_t value);
@@ -0,0 +1,95 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_TaggedAudioBuffer.hpp"
+#include "Data/sg_AudioStructs.hpp"
+#include "Data/sg_Macros.hpp"
+#include "Data/sg_constants.hpp"
+#include "sg_HighpassBank.hpp"
+
+#include <JuceHeader.h>
+
+#include <memory>
+
+namespace gris
+{
+/* An AudioConfig compiled into what the audio thread actually has to do.
+
+   The message thread sorts the channels by the work they need once, when the
+   config is published, instead of the audio thread looking up and branching
+   on every channel's config at every block. Each list is then processed by a
+   tight loop. The plan travels to the audio thread along with the config it
+   was compiled from and points into it, so it never outlives it.
+
+   Gains and mutes are not part of the plan : they change without a new config
+   and are read from AudioParameters at every block.
+*/
+struct ExecutionPlan {
+    struct GainStep {
+        output_patch_t speaker{};
+    };
+    struct HighpassStep {
+        output_patch_t speaker{};
+        SpeakerHighpassConfig const * highpassConfig{};
+    };
+    //==============================================================================
+    // Every source of the config.
+    juce::Array<source_index_t> sources{};
+    // Every speaker of the config.
+    StaticVector<output_patch_t, MAX_NUM_SPEAKERS> speakers{};
+    // Speakers that only need their gain applied.
+    juce::Array<GainStep> gainSteps{};
+    // Speakers with a highpass that are not part of the highpass bank.
+    juce::Array<HighpassStep> highpassSteps{};
+    // Speakers sharing a crossover frequency. Handles their gain, mute and peak on its own.
+    std::unique_ptr<HighpassBank> highpassBank{};
+    //==============================================================================
+    [[nodiscard]] static std::unique_ptr<ExecutionPlan> make(AudioConfig const & config)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+
+        auto plan{ std::make_unique<ExecutionPlan>() };
+
+        for (auto const & source : config.sourcesAudioConfig) {
+            plan->sources.add(source.key);
+        }
+
+        plan->highpassBank = HighpassBank::make(config);
+
+        for (auto const & speaker : config.speakersAudioConfig) {
+            auto const & speakerConfig{ *speaker.value };
+            plan->speakers.push_back(speaker.key);
+
+            if (plan->highpassBank && plan->highpassBank->contains(speaker.key)) {
+                continue;
+            }
+
+            if (speakerConfig.highpassConfig) {
+                plan->highpassSteps.add(HighpassStep{ speaker.key, &*speakerConfig.highpassConfig });
+            } else {
+                plan->gainSteps.add(GainStep{ speaker.key });
+            }
+        }
+
+        return plan;
+    }
+};
+} // namespace gris
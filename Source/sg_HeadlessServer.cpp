@@ -0,0 +1,468 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_HeadlessServer.hpp"
+
+#include "Misc/sg_DefaultFiles.hpp"
+#include "sg_AudioManager.hpp"
+#include "sg_JackVirtualPorts.hpp"
+#include "sg_MulticoreTuning.hpp"
+#include "sg_SimulatedAudioDevice.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+
+namespace gris
+{
+//==============================================================================
+HeadlessServer::~HeadlessServer()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    stopTimer();
+    if (mOscInput) {
+        mOscInput->closeConnection();
+        mOscInput.reset();
+    }
+    mAudioProcessor.reset();
+}
+
+//==============================================================================
+juce::String HeadlessServer::getUsage()
+{
+    return "Usage: SpatGRIS --headless [--project=<file>] [--speakers=<file>] [--osc-port=<port>]\n"
+           "                           [--simulated] [--sample-rate=<hz>] [--buffer-size=<samples>]\n"
+           "                           [--calibrate]";
+}
+
+//==============================================================================
+tl::optional<HeadlessServer::Options> HeadlessServer::parseOptions(juce::ArgumentList const & arguments,
+                                                                   juce::String & error)
+{
+    auto const getFile = [&](char const * const option) -> juce::File {
+        auto const value{ arguments.getValueForOption(option).unquoted() };
+        if (value.isEmpty()) {
+            return {};
+        }
+        return juce::File::getCurrentWorkingDirectory().getChildFile(value);
+    };
+
+    Options result{};
+    result.project = getFile("--project");
+    result.speakerSetup = getFile("--speakers");
+
+    if (arguments.containsOption("--osc-port")) {
+        auto const port{ arguments.getValueForOption("--osc-port").getIntValue() };
+        if (port <= 0 || port > 65535) {
+            error = "--osc-port must be between 1 and 65535.";
+            return tl::nullopt;
+        }
+        result.oscPort = port;
+    }
+
+    result.simulatedDevice = arguments.containsOption("--simulated");
+    if (arguments.containsOption("--sample-rate")) {
+        auto const sampleRate{ arguments.getValueForOption("--sample-rate").getDoubleValue() };
+        if (sampleRate < 8000.0 || sampleRate > 384000.0) {
+            error = "--sample-rate must be between 8000 and 384000.";
+            return tl::nullopt;
+        }
+        result.sampleRate = sampleRate;
+    }
+    if (arguments.containsOption("--buffer-size")) {
+        auto const bufferSize{ arguments.getValueForOption("--buffer-size").getIntValue() };
+        if (bufferSize < 16 || bufferSize > 8192) {
+            error = "--buffer-size must be between 16 and 8192.";
+            return tl::nullopt;
+        }
+        result.bufferSize = bufferSize;
+    }
+    result.calibrate = arguments.containsOption("--calibrate");
+
+    return result;
+}
+
+//==============================================================================
+bool HeadlessServer::start(juce::String & error)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    mData.appData = mConfiguration.load();
+
+    // Load the project and the speaker setup
+    auto const pickFile = [](juce::File const & option, juce::String const & lastFile, juce::File const & fallback) {
+        if (option != juce::File{}) {
+            return option;
+        }
+        juce::File const last{ lastFile };
+        return lastFile.isNotEmpty() && last.existsAsFile() ? last : fallback;
+    };
+    auto const projectFile{ pickFile(mOptions.project, mData.appData.lastProject, DEFAULT_PROJECT_FILE) };
+    auto const speakerSetupFile{ pickFile(mOptions.speakerSetup,
+                                          mData.appData.lastSpeakerSetup,
+                                          DEFAULT_SPEAKER_SETUP_FILE) };
+
+    auto project{ session::readProject(projectFile, error) };
+    if (!project) {
+        return false;
+    }
+    auto speakerSetup{ session::readSpeakerSetup(speakerSetupFile, error) };
+    if (!speakerSetup) {
+        return false;
+    }
+    mData.project = std::move(*project);
+    mData.speakerSetup = std::move(*speakerSetup);
+    session::reconcileSpatModes(mData);
+    log("Project: " + projectFile.getFullPathName());
+    log("Speaker setup: " + speakerSetupFile.getFullPathName());
+
+    // Open the audio device
+    jackVirtualPorts::applyStoredCounts();
+    auto & audioSettings{ mData.appData.audioSettings };
+    if (mOptions.simulatedDevice) {
+        audioSettings.deviceType = SimulatedAudioIODevice::TYPE_NAME;
+        audioSettings.inputDevice = SimulatedAudioIODevice::DEVICE_NAME;
+        audioSettings.outputDevice = SimulatedAudioIODevice::DEVICE_NAME;
+    }
+    audioSettings.sampleRate = mOptions.sampleRate.value_or(audioSettings.sampleRate);
+    audioSettings.bufferSize = mOptions.bufferSize.value_or(audioSettings.bufferSize);
+    AudioManager::init(audioSettings.deviceType,
+                       audioSettings.inputDevice,
+                       audioSettings.outputDevice,
+                       audioSettings.sampleRate,
+                       audioSettings.bufferSize,
+                       mData.appData.stereoMode ? tl::make_optional(mData.appData.stereoRouting) : tl::nullopt,
+                       mOptions.simulatedDevice);
+    auto & audioManager{ AudioManager::getInstance() };
+    auto * audioDevice{ audioManager.getAudioDeviceManager().getCurrentAudioDevice() };
+    if (!audioDevice) {
+        error = "Unable to open an audio device.";
+        return false;
+    }
+    mData.appData.audioSettings.sampleRate = audioDevice->getCurrentSampleRate();
+    mData.appData.audioSettings.bufferSize = audioDevice->getCurrentBufferSizeSamples();
+    log("Audio device: " + audioDevice->getName() + ", "
+        + juce::String{ mData.appData.audioSettings.sampleRate, 0 } + " Hz, "
+        + juce::String{ mData.appData.audioSettings.bufferSize } + " samples");
+
+    // Build the audio processor
+    mAudioProcessor = std::make_unique<AudioProcessor>();
+    mAudioProcessor->setBufferSize(mData.appData.audioSettings.bufferSize);
+    // Nothing renders yet : a calibration is timed on an idle machine.
+    if (mOptions.calibrate) {
+        multicoreTuning::setEnabled(true);
+    }
+    {
+        juce::ScopedLock const lock{ mLock };
+        rebuildSpatAlgorithm(mOptions.calibrate);
+    }
+    {
+        juce::ScopedLock const audioLock{ mAudioProcessor->getLock() };
+        audioManager.registerAudioProcessor(mAudioProcessor.get());
+    }
+
+    // Listen to OSC
+    auto const oscPort{ mOptions.oscPort.value_or(mData.appData.networkSettings.oscPort) };
+    mOscInput = std::make_unique<OscInput>(*this, mLogBuffer);
+    if (!mOscInput->startConnection(oscPort)) {
+        error = "Unable to listen to OSC messages on port " + juce::String{ oscPort } + ".";
+        return false;
+    }
+    log("Listening to OSC messages on port " + juce::String{ oscPort } + ".");
+
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    startTimer(250);
+    return true;
+}
+
+//==============================================================================
+int HeadlessServer::getNumSources()
+{
+    juce::ScopedLock const lock{ mLock };
+    return mData.project.sources.size();
+}
+
+//==============================================================================
+HeadlessServer::OscStats HeadlessServer::getOscStats()
+{
+    juce::ScopedLock const lock{ mLock };
+    return mOscStats;
+}
+
+//==============================================================================
+void HeadlessServer::setLegacySourcePosition(source_index_t const sourceIndex,
+                                             radians_t const azimuth,
+                                             radians_t const elevation,
+                                             float const length,
+                                             float const newAzimuthSpan,
+                                             float const newZenithSpan)
+{
+    auto const waitStart{ juce::Time::getHighResolutionTicks() };
+    juce::ScopedLock const lock{ mLock };
+    mOscStats.lockWait.add(getMsSince(waitStart));
+
+    if (!mData.project.sources.contains(sourceIndex)) {
+        return;
+    }
+
+    auto & source{ mData.project.sources[sourceIndex] };
+    source.position = session::correctLegacySourcePosition(mData, sourceIndex, azimuth, elevation, length);
+    source.azimuthSpan = newAzimuthSpan;
+    source.zenithSpan = newZenithSpan;
+    updateSpatData(sourceIndex);
+}
+
+//==============================================================================
+void HeadlessServer::setSourcePosition(source_index_t const sourceIndex,
+                                       Position const position,
+                                       float const azimuthSpan,
+                                       float const zenithSpan)
+{
+    auto const waitStart{ juce::Time::getHighResolutionTicks() };
+    juce::ScopedLock const lock{ mLock };
+    mOscStats.lockWait.add(getMsSince(waitStart));
+
+    if (!mData.project.sources.contains(sourceIndex)) {
+        return;
+    }
+
+    auto & source{ mData.project.sources[sourceIndex] };
+    source.position = session::correctSourcePosition(mData, sourceIndex, position);
+    source.azimuthSpan = std::clamp(azimuthSpan, 0.0f, 1.0f);
+    source.zenithSpan = std::clamp(zenithSpan, 0.0f, 1.0f);
+    updateSpatData(sourceIndex);
+}
+
+//==============================================================================
+void HeadlessServer::resetSourcePosition(source_index_t const sourceIndex)
+{
+    auto const waitStart{ juce::Time::getHighResolutionTicks() };
+    juce::ScopedLock const lock{ mLock };
+    mOscStats.lockWait.add(getMsSince(waitStart));
+
+    if (!mData.project.sources.contains(sourceIndex)) {
+        return;
+    }
+
+    auto & source{ mData.project.sources[sourceIndex] };
+    source.position = tl::nullopt;
+    updateSpatData(sourceIndex);
+}
+
+//==============================================================================
+void HeadlessServer::setSourceHybridSpatMode(source_index_t const sourceIndex, SpatMode const spatMode)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedLock const lock{ mLock };
+
+    if (!mData.project.sources.contains(sourceIndex)) {
+        return;
+    }
+
+    auto & source{ mData.project.sources[sourceIndex] };
+    source.hybridSpatMode = spatMode;
+
+    // Erase the position from the previous algorithm before handing it to the new one.
+    auto const position{ source.position };
+    source.position = tl::nullopt;
+    updateSpatData(sourceIndex);
+    source.position = position;
+    updateSpatData(sourceIndex);
+}
+
+//==============================================================================
+void HeadlessServer::setSourceColor(source_index_t const sourceIndex, juce::Colour const colour)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedLock const lock{ mLock };
+
+    if (mData.project.sources.contains(sourceIndex)) {
+        mData.project.sources[sourceIndex].colour = colour;
+    }
+}
+
+//==============================================================================
+void HeadlessServer::setSourceState(source_index_t const sourceIndex, SliceState const state)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedLock const lock{ mLock };
+
+    if (mData.project.sources.contains(sourceIndex)) {
+        mData.project.sources[sourceIndex].state = state;
+        refreshAudioParameters();
+    }
+}
+
+//==============================================================================
+void HeadlessServer::setSpeakerState(output_patch_t const outputPatch, SliceState const state)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedLock const lock{ mLock };
+
+    if (mData.speakerSetup.speakers.contains(outputPatch)) {
+        mData.speakerSetup.speakers[outputPatch].state = state;
+        refreshAudioParameters();
+    }
+}
+
+//==============================================================================
+void HeadlessServer::setMasterGain(dbfs_t const gain)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedLock const lock{ mLock };
+
+    mData.project.masterGain = gain;
+    refreshAudioParameters();
+}
+
+//==============================================================================
+void HeadlessServer::setSpeakerGain(output_patch_t const outputPatch, dbfs_t const gain)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedLock const lock{ mLock };
+
+    if (mData.speakerSetup.speakers.contains(outputPatch)) {
+        mData.speakerSetup.speakers[outputPatch].gain = gain;
+        refreshAudioParameters();
+    }
+}
+
+//==============================================================================
+void HeadlessServer::openProject(juce::File const & file)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    juce::String error{};
+    auto project{ session::readProject(file, error) };
+    if (!project) {
+        log("Error: " + error);
+        return;
+    }
+
+    juce::ScopedLock const lock{ mLock };
+    mData.project = std::move(*project);
+    session::reconcileSpatModes(mData);
+    log("Project: " + file.getFullPathName());
+    rebuildSpatAlgorithm();
+}
+
+//==============================================================================
+void HeadlessServer::openSpeakerSetup(juce::File const & file)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    juce::String error{};
+    auto speakerSetup{ session::readSpeakerSetup(file, error) };
+    if (!speakerSetup) {
+        log("Error: " + error);
+        return;
+    }
+
+    juce::ScopedLock const lock{ mLock };
+    mData.speakerSetup = std::move(*speakerSetup);
+    session::reconcileSpatModes(mData);
+    log("Speaker setup: " + file.getFullPathName());
+    rebuildSpatAlgorithm();
+}
+
+//==============================================================================
+void HeadlessServer::log(juce::String const & message)
+{
+    std::cout << message << std::endl;
+}
+
+//==============================================================================
+double HeadlessServer::getMsSince(juce::int64 const startTicks)
+{
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+}
+
+//==============================================================================
+void HeadlessServer::rebuildSpatAlgorithm(bool const shouldCalibrate)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    session::BuildOutcome buildOutcome{};
+    auto spatAlgorithm{ shouldCalibrate ? session::calibrate(mData, buildOutcome)
+                                        : session::makeSpatAlgorithm(mData, buildOutcome) };
+    if (buildOutcome.report.isNotEmpty()) {
+        log(buildOutcome.report);
+    }
+    session::adopt(buildOutcome);
+    if (auto const spatError{ spatAlgorithm->getError() }) {
+        // Like the GUI, keep running with the spatialization disabled.
+        log("Warning: " + session::spatAlgorithmErrorToString(*spatError));
+    }
+    if (mData.appData.stereoMode == StereoMode::hrtf) {
+        spatAlgorithm->setCallback([](int const state) {
+            if (state == 1) {
+                log("Warning: unable to load the SOFA file, using the default binaural profile.");
+            }
+        });
+    }
+    session::assignSourcesPositions(*spatAlgorithm, mData);
+    mAudioProcessor->setSpatAlgorithm(std::move(spatAlgorithm));
+    mAudioProcessor->setSilenceHoldSeconds(SilenceGate::getHoldSecondsFor(mData));
+    mAudioProcessor->setAudioConfig(mData.toAudioConfig());
+}
+
+//==============================================================================
+void HeadlessServer::refreshAudioParameters()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    auto & parameters{ mAudioProcessor->getParameters() };
+    parameters.setMasterGain(mData.project.masterGain.toGain());
+    parameters.setStereoMuted(mData.speakerSetup.generalMute);
+
+    auto const isAtLeastOneSourceSolo{ MuteSoloComponent::isSoloMode(mData.project.sources) };
+    for (auto const source : mData.project.sources) {
+        parameters.setSourceMuted(source.key,
+                                  MuteSoloComponent::isMuted(source.value->state, isAtLeastOneSourceSolo));
+    }
+
+    auto const isAtLeastOneSpeakerSolo{ MuteSoloComponent::isSoloMode(mData.speakerSetup.speakers) };
+    for (auto const speaker : mData.speakerSetup.speakers) {
+        parameters.setSpeakerGain(speaker.key, speaker.value->gain.toGain());
+        parameters.setSpeakerMuted(speaker.key,
+                                   MuteSoloComponent::isMuted(speaker.value->state, isAtLeastOneSpeakerSolo));
+    }
+}
+
+//==============================================================================
+void HeadlessServer::updateSpatData(source_index_t const sourceIndex)
+{
+    auto const start{ juce::Time::getHighResolutionTicks() };
+    mAudioProcessor->getSpatAlgorithm()->updateSpatData(sourceIndex, mData.project.sources[sourceIndex]);
+    mOscStats.updateSpatData.add(getMsSince(start));
+}
+
+//==============================================================================
+void HeadlessServer::timerCallback()
+{
+    mAudioProcessor->collectRetired();
+
+    if (mStopRequested.exchange(false)) {
+        log("Stopping.");
+        juce::JUCEApplicationBase::quit();
+    }
+}
+} // namespace gris
@@ -0,0 +1,156 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_LogBuffer.hpp"
+#include "sg_AudioCallbackMonitor.hpp"
+#include "sg_AudioProcessor.hpp"
+#include "sg_Configuration.hpp"
+#include "sg_MuteSoloComponent.hpp"
+#include "sg_OscInput.hpp"
+#include "sg_SessionUtilities.hpp"
+
+#include <JuceHeader.h>
+
+#include <atomic>
+
+namespace gris
+{
+/* Runs the spatialization engine without any window :
+
+     SpatGRIS --headless [--project=<file>] [--speakers=<file>] [--osc-port=<port>]
+                         [--simulated] [--sample-rate=<hz>] [--buffer-size=<samples>]
+                         [--calibrate]
+
+   The audio device, the stereo mode and the OSC port are the ones saved by the
+   GUI in the application settings, unless --simulated replaces the device with
+   the one of sg_SimulatedAudioDevice.hpp, which needs no hardware. The project
+   and the speaker setup default to the last ones opened by the GUI.
+
+   --calibrate times the multicore DSP for the setup before the audio starts,
+   on an otherwise idle machine, and enables the automatic tuning : see
+   sg_MulticoreTuning.hpp. It is the only option that writes to the settings.
+
+   Everything else goes through the /spat/serv OSC messages : the positions,
+   the hybrid modes and the colours of the sources, the mute and solo states of
+   the sources and the speakers, the master and speaker gains, and loading
+   another project or speaker setup. A file that fails to load is reported and
+   the current one is kept. OSC messages wait while a new speaker setup is
+   triangulated.
+
+   Nothing is drawn and the message thread only wakes up a few times per second
+   to check for SIGINT or SIGTERM, which stop the server. The other settings are
+   never written back, so a headless server cannot change what the GUI opens
+   next.
+*/
+class HeadlessServer final
+    : public OscInput::Listener
+    , private juce::Timer
+{
+public:
+    static constexpr auto const * HEADLESS_OPTION = "--headless";
+
+    //==============================================================================
+    struct Options {
+        juce::File project{};
+        juce::File speakerSetup{};
+        tl::optional<int> oscPort{};
+        bool simulatedDevice{};
+        tl::optional<double> sampleRate{};
+        tl::optional<int> bufferSize{};
+        bool calibrate{};
+    };
+
+    //==============================================================================
+    /* Where the OSC thread spends its time. It never takes a lock that the audio callback takes : it only shares the
+       positions handed over by updateSpatData() with it, and waits for the message thread on mLock. */
+    struct OscStats {
+        DurationHistogram lockWait{};
+        DurationHistogram updateSpatData{};
+    };
+
+private:
+    //==============================================================================
+    Options mOptions{};
+    Configuration mConfiguration{};
+    // Guards mData, which the OSC thread modifies, and mOscStats.
+    juce::CriticalSection mLock{};
+    SpatGrisData mData{};
+    OscStats mOscStats{};
+    std::unique_ptr<AudioProcessor> mAudioProcessor{};
+    LogBuffer mLogBuffer{};
+    std::unique_ptr<OscInput> mOscInput{};
+
+    static inline std::atomic<bool> mStopRequested{};
+
+public:
+    //==============================================================================
+    explicit HeadlessServer(Options options) : mOptions(std::move(options)) {}
+    HeadlessServer() = delete;
+    ~HeadlessServer() override;
+    SG_DELETE_COPY_AND_MOVE(HeadlessServer)
+    //==============================================================================
+    [[nodiscard]] static juce::String getUsage();
+    [[nodiscard]] static tl::optional<Options> parseOptions(juce::ArgumentList const & arguments,
+                                                            juce::String & error);
+    /* Opens the audio device and starts listening to OSC. The server then runs until the process is asked to stop. */
+    [[nodiscard]] bool start(juce::String & error);
+    [[nodiscard]] int getNumSources();
+    [[nodiscard]] OscStats getOscStats();
+    //==============================================================================
+    // OscInput::Listener
+    void setLegacySourcePosition(source_index_t const sourceIndex,
+                                 radians_t const azimuth,
+                                 radians_t const elevation,
+                                 float const length,
+                                 float const newAzimuthSpan,
+                                 float const newZenithSpan) override;
+    void setSourcePosition(source_index_t const sourceIndex,
+                           Position const position,
+                           float const azimuthSpan,
+                           float const zenithSpan) override;
+    void resetSourcePosition(source_index_t const sourceIndex) override;
+    void setSourceHybridSpatMode(source_index_t const sourceIndex, SpatMode const spatMode) override;
+    void setSourceColor(source_index_t const sourceIndex, juce::Colour const colour) override;
+    void setSourceState(source_index_t const sourceIndex, SliceState const state) override;
+    void setSpeakerState(output_patch_t const outputPatch, SliceState const state) override;
+    void setMasterGain(dbfs_t const gain) override;
+    void setSpeakerGain(output_patch_t const outputPatch, dbfs_t const gain) override;
+    void openProject(juce::File const & file) override;
+    void openSpeakerSetup(juce::File const & file) override;
+
+private:
+    //==============================================================================
+    static void log(juce::String const & message);
+    static void requestStop(int /*signal*/) { mStopRequested.store(true); }
+    [[nodiscard]] static double getMsSince(juce::int64 const startTicks);
+    /* Message thread, with mLock held. Builds the algorithm for mData, calibrating it first if asked to, and
+       publishes it with its config. The audio thread keeps rendering with the previous one until then. */
+    void rebuildSpatAlgorithm(bool const shouldCalibrate = false);
+    /* Message thread, with mLock held. Same as MainContentComponent::refreshAudioParameters(). */
+    void refreshAudioParameters();
+    /* Must be called with mLock held. */
+    void updateSpatData(source_index_t const sourceIndex);
+    //==============================================================================
+    void timerCallback() override;
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(HeadlessServer)
+};
+} // namespace gris
@@ -0,0 +1,285 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_StrongArray.hpp"
+#include "Containers/sg_TaggedAudioBuffer.hpp"
+#include "Data/sg_AudioStructs.hpp"
+#include "Data/sg_Macros.hpp"
+#include "Data/sg_constants.hpp"
+#include "sg_AudioKernels.hpp"
+#include "sg_AudioParameters.hpp"
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace gris
+{
+/* Runs the speaker highpass filters of several speakers in lockstep.
+
+   A highpass filter is recursive, so a single speaker cannot be vectorized
+   across time. Speakers that share the same crossover frequency also share
+   the same coefficients, though, so they are grouped in lanes of NUM_LANES
+   speakers. Their samples are interleaved in a small scratch buffer, filtered
+   with one lane per speaker, then written back. The lane loops have a constant
+   trip count and no branches, so the compiler turns them into AVX2 or NEON
+   code, and plain scalar code elsewhere.
+
+   The bank is built by the message thread from an AudioConfig and travels to
+   the audio thread with it. The filter states stay in the speakers audio
+   state : they are loaded into the lanes at the start of every block and
+   stored back at the end, so the scalar path and the bank can take over from
+   each other when the config changes.
+
+   The recursion is the one of kernels::applyGainHighpassAndGetPeak(), and so
+   is the remedy against denormals : a tiny random offset, drawn from the
+   processor's juce::Random, is added to every input sample. The offsets are
+   drawn once per frame and shared by the lanes, so the output matches the
+   scalar path within that noise and not bit for bit. kernelBenchmark::measureHighpassBank()
+   reports the largest difference.
+
+   The coefficients are copied into the bank when it is built, along with a
+   pointer to each speaker's filter config, so process() never looks anything
+   up in the AudioConfig.
+*/
+class HighpassBank
+{
+public:
+    static constexpr int NUM_LANES = 8;
+    static constexpr double DENORMAL_NOISE = kernels::DENORMAL_NOISE;
+
+private:
+    static constexpr int CHUNK_SIZE = 64;
+    //==============================================================================
+    using Lanes = std::array<double, NUM_LANES>;
+    struct alignas(64) Frame {
+        Lanes values{};
+    };
+    //==============================================================================
+    struct Group {
+        // The coefficients shared by all the speakers of the group.
+        double b1{};
+        double b2{};
+        double b3{};
+        double b4{};
+        double ha0{};
+        double ha1{};
+        double ha2{};
+        std::array<output_patch_t, NUM_LANES> speakers{};
+        // Owned by the AudioConfig the bank was built from, which travels with it. Only used for isNewConfig.
+        std::array<SpeakerHighpassConfig const *, NUM_LANES> highpassConfigs{};
+        int numSpeakers{};
+    };
+    //==============================================================================
+    juce::Array<Group> mGroups{};
+    StrongArray<output_patch_t, bool, MAX_NUM_SPEAKERS> mIsBanked{};
+    // Audio thread scratch buffer.
+    std::array<Frame, CHUNK_SIZE> mFrames{};
+    std::array<double, CHUNK_SIZE> mNoise{};
+
+public:
+    //==============================================================================
+    HighpassBank() = default;
+    ~HighpassBank() = default;
+    SG_DELETE_COPY_AND_MOVE(HighpassBank)
+    //==============================================================================
+    /* Returns nullptr when no two speakers share a crossover frequency. */
+    [[nodiscard]] static std::unique_ptr<HighpassBank> make(AudioConfig const & config)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+
+        auto bank{ std::make_unique<HighpassBank>() };
+
+        for (auto const & speaker : config.speakersAudioConfig) {
+            if (!speaker.value->highpassConfig) {
+                continue;
+            }
+            auto const & highpassConfig{ *speaker.value->highpassConfig };
+            auto const hasSameCoefficients = [&](Group const & group) {
+                return group.numSpeakers < NUM_LANES && group.b1 == highpassConfig.b1 && group.b2 == highpassConfig.b2
+                       && group.b3 == highpassConfig.b3 && group.b4 == highpassConfig.b4
+                       && group.ha0 == highpassConfig.ha0 && group.ha1 == highpassConfig.ha1
+                       && group.ha2 == highpassConfig.ha2;
+            };
+
+            auto * group{ std::find_if(bank->mGroups.begin(), bank->mGroups.end(), hasSameCoefficients) };
+            if (group == bank->mGroups.end()) {
+                bank->mGroups.add(Group{ highpassConfig.b1,
+                                         highpassConfig.b2,
+                                         highpassConfig.b3,
+                                         highpassConfig.b4,
+                                         highpassConfig.ha0,
+                                         highpassConfig.ha1,
+                                         highpassConfig.ha2 });
+                group = &bank->mGroups.getReference(bank->mGroups.size() - 1);
+            }
+            auto const lane{ static_cast<size_t>(group->numSpeakers++) };
+            group->speakers[lane] = speaker.key;
+            group->highpassConfigs[lane] = &highpassConfig;
+        }
+
+        // A single speaker is cheaper to filter with the scalar path.
+        bank->mGroups.removeIf([](Group const & group) { return group.numSpeakers < 2; });
+        if (bank->mGroups.isEmpty()) {
+            return nullptr;
+        }
+
+        for (auto const & group : bank->mGroups) {
+            for (int lane{}; lane < group.numSpeakers; ++lane) {
+                bank->mIsBanked[group.speakers[static_cast<size_t>(lane)]] = true;
+            }
+        }
+        return bank;
+    }
+
+    //==============================================================================
+    /* True if the speaker is entirely handled by process(), including its gain, mute and peak. */
+    [[nodiscard]] bool contains(output_patch_t const speaker) const noexcept { return mIsBanked[speaker]; }
+
+    //==============================================================================
+    /* Audio thread. Applies gain and highpass to the speakers of the bank and writes their peaks. Must be used with
+       the AudioConfig it was built from. */
+    template<typename SpeakersAudioState>
+    void process(AudioParameters & parameters,
+                 SpeakerAudioBuffer & speakersBuffer,
+                 SpeakersAudioState & speakersAudioState,
+                 SpeakerPeaks & peaks,
+                 juce::Random & randomNoise) noexcept
+    {
+        auto const numSamples{ speakersBuffer.getNumSamples() };
+
+        for (auto const & group : mGroups) {
+            std::array<float *, NUM_LANES> samples{};
+            std::array<float, NUM_LANES> gains{};
+            Lanes x1{}, x2{}, x3{}, x4{}, y1{}, y2{}, y3{}, y4{};
+            Lanes lanePeaks{};
+
+            for (int lane{}; lane < group.numSpeakers; ++lane) {
+                auto const laneIndex{ static_cast<size_t>(lane) };
+                auto const speaker{ group.speakers[laneIndex] };
+                auto const & highpassConfig{ *group.highpassConfigs[laneIndex] };
+                auto & buffer{ speakersBuffer[speaker] };
+                auto const gain{ parameters.applySpeakerGainRamp(speaker, buffer.getWritePointer(0), numSamples) };
+                if (gain < SMALL_GAIN) {
+                    // The lane filters silence and its state is left untouched, like the scalar path does.
+                    buffer.clear();
+                    continue;
+                }
+
+                auto & highpassState{ speakersAudioState[speaker].highpassState };
+                if (highpassConfig.isNewConfig) {
+                    highpassState.resetValues();
+                    highpassConfig.isNewConfig = false;
+                }
+
+                samples[laneIndex] = buffer.getWritePointer(0);
+                gains[laneIndex] = gain;
+                x1[laneIndex] = highpassState.x1;
+                x2[laneIndex] = highpassState.x2;
+                x3[laneIndex] = highpassState.x3;
+                x4[laneIndex] = highpassState.x4;
+                y1[laneIndex] = highpassState.y1;
+                y2[laneIndex] = highpassState.y2;
+                y3[laneIndex] = highpassState.y3;
+                y4[laneIndex] = highpassState.y4;
+            }
+
+            for (int start{}; start < numSamples; start += CHUNK_SIZE) {
+                auto const chunkSize{ std::min(CHUNK_SIZE, numSamples - start) };
+
+                for (int i{}; i < chunkSize; ++i) {
+                    mNoise[static_cast<size_t>(i)] = (randomNoise.nextDouble() - 0.5) * DENORMAL_NOISE;
+                }
+
+                // Interleave
+                for (size_t lane{}; lane < NUM_LANES; ++lane) {
+                    auto const * const laneSamples{ samples[lane] };
+                    for (int i{}; i < chunkSize; ++i) {
+                        auto const index{ static_cast<size_t>(i) };
+                        mFrames[index].values[lane]
+                            = laneSamples ? static_cast<double>(laneSamples[start + i] * gains[lane]) + mNoise[index]
+                                          : 0.0;
+                    }
+                }
+
+                // Filter
+                for (int i{}; i < chunkSize; ++i) {
+                    auto & frame{ mFrames[static_cast<size_t>(i)].values };
+                    for (size_t lane{}; lane < NUM_LANES; ++lane) {
+                        auto const x{ frame[lane] };
+                        auto const y{ group.ha0 * x + group.ha1 * x1[lane] + group.ha2 * x2[lane]
+                                      + group.ha1 * x3[lane] + group.ha0 * x4[lane] - group.b1 * y1[lane]
+                                      - group.b2 * y2[lane] - group.b3 * y3[lane] - group.b4 * y4[lane] };
+                        x4[lane] = x3[lane];
+                        x3[lane] = x2[lane];
+                        x2[lane] = x1[lane];
+                        x1[lane] = x;
+                        y4[lane] = y3[lane];
+                        y3[lane] = y2[lane];
+                        y2[lane] = y1[lane];
+                        y1[lane] = y;
+                        frame[lane] = y;
+                        lanePeaks[lane] = std::max(lanePeaks[lane], std::abs(y));
+                    }
+                }
+
+                // De-interleave
+                for (size_t lane{}; lane < NUM_LANES; ++lane) {
+                    auto * const laneSamples{ samples[lane] };
+                    if (!laneSamples) {
+                        continue;
+                    }
+                    for (int i{}; i < chunkSize; ++i) {
+                        laneSamples[start + i] = static_cast<float>(mFrames[static_cast<size_t>(i)].values[lane]);
+                    }
+                }
+            }
+
+            for (int lane{}; lane < group.numSpeakers; ++lane) {
+                auto const laneIndex{ static_cast<size_t>(lane) };
+                auto const speaker{ group.speakers[laneIndex] };
+                if (!samples[laneIndex]) {
+                    peaks[speaker] = 0.0f;
+                    continue;
+                }
+
+                auto & highpassState{ speakersAudioState[speaker].highpassState };
+                highpassState.x1 = x1[laneIndex];
+                highpassState.x2 = x2[laneIndex];
+                highpassState.x3 = x3[laneIndex];
+                highpassState.x4 = x4[laneIndex];
+                highpassState.y1 = y1[laneIndex];
+                highpassState.y2 = y2[laneIndex];
+                highpassState.y3 = y3[laneIndex];
+                highpassState.y4 = y4[laneIndex];
+                peaks[speaker] = static_cast<float>(lanePeaks[laneIndex]);
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(HighpassBank)
+};
+} // namespace gris
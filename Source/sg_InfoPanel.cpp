@@ -19,12 +19,13 @@
 
 #include "sg_InfoPanel.hpp"
 
+#include "sg_AudioCallbackMonitor.hpp"
 #include "sg_GrisLookAndFeel.hpp"
 #include "sg_MainComponent.hpp"
 
 namespace
 {
-constexpr auto MIN_WIDTH = 400;
+constexpr auto MIN_WIDTH = 780;
 constexpr auto MIN_HEIGHT = 25;
 auto const COLOR_1 = juce::Colours::blue.withBrightness(0.3f).withSaturation(0.2f);
 auto const COLOR_2 = juce::Colours::blue.withBrightness(0.2f).withSaturation(0.2f);
@@ -52,6 +53,10 @@ InfoPanel::InfoPanel(MainContentComponent & mainContentComponent, GrisLookAndFee
     }
 
     setComponentsColors(labels);
+
+    mBuildProgressBar.setColour(juce::ProgressBar::ColourIds::backgroundColourId, glaf.getWinBackgroundColour());
+    mBuildProgressBar.setColour(juce::ProgressBar::ColourIds::foregroundColourId, glaf.getOnColour());
+    addChildComponent(mBuildProgressBar);
 }
 
 //==============================================================================
@@ -111,11 +116,83 @@ void InfoPanel::setNumOutputs(int const numOutputs)
     mNumOutputsLabel.setText(string, juce::dontSendNotification);
 }
 
+//==============================================================================
+void InfoPanel::setAudioCallbackStats(AudioCallbackStats const & stats, int const numXRuns)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    auto const & processingTime{ stats.processingTime };
+    auto const toString = [](double const ms) { return juce::String{ ms, 2 }; };
+    mBlockTimeLabel.setText("Block: " + toString(processingTime.getPercentileMs(50.0)) + " / "
+                                + toString(processingTime.getPercentileMs(99.0)) + " / "
+                                + toString(processingTime.maxMs) + " ms",
+                            juce::dontSendNotification);
+    mBlockTimeLabel.setTooltip("Time spent processing a block (p50 / p99 / max) out of "
+                               + toString(stats.blockDurationMs) + " ms available.\nCallback jitter (p50 / p99 / max): "
+                               + toString(stats.jitter.getPercentileMs(50.0)) + " / "
+                               + toString(stats.jitter.getPercentileMs(99.0)) + " / " + toString(stats.jitter.maxMs)
+                               + " ms.\nClick to reset.");
+
+    auto const numSkippedBlocks{ stats.getNumSkippedBlocks() };
+    auto const xRunsString{ numXRuns < 0 ? juce::String{ "-" } : juce::String{ numXRuns } };
+    mDropoutsLabel.setText("Skipped: " + juce::String{ numSkippedBlocks } + ", xruns: " + xRunsString,
+                           juce::dontSendNotification);
+
+    juce::String tooltip{ "Blocks skipped by SpatGRIS, by reason:" };
+    for (std::size_t i{}; i < stats.skippedBlocks.size(); ++i) {
+        tooltip << "\n" << skippedBlockReasonToString(static_cast<SkippedBlockReason>(i)) << ": "
+                << juce::String{ stats.skippedBlocks[i] };
+    }
+    tooltip << "\nXruns are reported by the audio device" << (numXRuns < 0 ? " (not supported by this one)." : ".")
+            << "\nClick to reset.";
+    mDropoutsLabel.setTooltip(tooltip);
+
+    auto const numProcessedBlocks{ processingTime.count };
+    auto const averageSkippedSources{ numProcessedBlocks == 0 ? 0.0
+                                                              : static_cast<double>(stats.totalSkippedSources)
+                                                                    / static_cast<double>(numProcessedBlocks) };
+    mSilentSourcesLabel.setText("Silent: " + juce::String{ stats.numSkippedSources } + " / "
+                                    + juce::String{ stats.numSources },
+                                juce::dontSendNotification);
+    mSilentSourcesLabel.setTooltip("Sources left out of the spatialization because they are quiet or muted, in the "
+                                   "last block.\nQuiet sources rendered to finish their HRTF tail: "
+                                   + juce::String{ stats.numHeldSources } + ".\nAverage skipped per block: "
+                                   + juce::String{ averageSkippedSources, 1 } + ".\nClick to reset.");
+
+    auto const hasDropouts{ numSkippedBlocks > 0 || numXRuns > 0 };
+    if (hasDropouts != mHasDropouts) {
+        mHasDropouts = hasDropouts;
+        setComponentsColors(getLabels());
+    }
+}
+
+//==============================================================================
+void InfoPanel::setSpatAlgorithmBuildStatus(juce::String const & status)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    if (status == mBuildStatus) {
+        return;
+    }
+    mBuildStatus = status;
+
+    mBuildProgressBar.setTextToDisplay(status);
+    if (mBuildProgressBar.isVisible() != status.isNotEmpty()) {
+        mBuildProgressBar.setVisible(status.isNotEmpty());
+        resized();
+    }
+}
+
 //==============================================================================
 void InfoPanel::resized()
 {
+    auto bounds{ getLocalBounds() };
+    if (mBuildProgressBar.isVisible()) {
+        mBuildProgressBar.setBounds(bounds.removeFromRight(bounds.getWidth() / 3));
+    }
+
     auto const labels = getLabels();
-    auto const availableWidth{ narrow<float>(getWidth()) };
+    auto const availableWidth{ narrow<float>(bounds.getWidth()) };
     auto const labelWidthFloat{ availableWidth / narrow<float>(labels.size()) };
     auto const labelWidthInt{ narrow<int>(std::round(labelWidthFloat)) };
     auto const height{ getHeight() };
@@ -131,6 +208,12 @@ void InfoPanel::resized()
 //==============================================================================
 void InfoPanel::mouseDown(juce::MouseEvent const & event)
 {
+    if (event.eventComponent == &mBlockTimeLabel || event.eventComponent == &mDropoutsLabel
+        || event.eventComponent == &mSilentSourcesLabel) {
+        mMainContentComponent.resetAudioCallbackStats();
+        return;
+    }
+
     if (event.eventComponent != &mCpuLabel) {
         mMainContentComponent.handleShowPreferences();
         return;
@@ -163,7 +246,10 @@ juce::Array<juce::Label *> InfoPanel::getLabels() noexcept
                                        &mSampleRateLabel,
                                        &mBufferSizeLabel,
                                        &mNumInputsLabel,
-                                       &mNumOutputsLabel };
+                                       &mNumOutputsLabel,
+                                       &mBlockTimeLabel,
+                                       &mDropoutsLabel,
+                                       &mSilentSourcesLabel };
 }
 
 //==============================================================================
@@ -184,6 +270,9 @@ void InfoPanel::setComponentsColors(juce::Array<juce::Label *> const & labels)
     if (mCpuIsCurrentlyPeaking) {
         mCpuLabel.setColour(juce::Label::ColourIds::backgroundColourId, PEAK_COLOR);
     }
+    if (mHasDropouts) {
+        mDropoutsLabel.setColour(juce::Label::ColourIds::outlineColourId, PEAK_COLOR);
+    }
 }
 
 } // namespace gris
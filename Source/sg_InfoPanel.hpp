@@ -23,6 +23,7 @@
 
 namespace gris
 {
+struct AudioCallbackStats;
 class GrisLookAndFeel;
 class MainContentComponent;
 
@@ -36,9 +37,18 @@ class InfoPanel final : public MinSizedComponent
     juce::Label mBufferSizeLabel{};
     juce::Label mNumInputsLabel{};
     juce::Label mNumOutputsLabel{};
+    juce::Label mBlockTimeLabel{};
+    juce::Label mDropoutsLabel{};
+    juce::Label mSilentSourcesLabel{};
+
+    // Shown next to the labels while a spatialization algorithm is being built.
+    double mBuildProgress{ -1.0 };
+    juce::ProgressBar mBuildProgressBar{ mBuildProgress };
+    juce::String mBuildStatus{};
 
     bool mCpuPeaked{};
     bool mCpuIsCurrentlyPeaking{};
+    bool mHasDropouts{};
 
 public:
     //==============================================================================
@@ -51,6 +61,9 @@ public:
     void setBufferSize(int bufferSize);
     void setNumInputs(int numInputs);
     void setNumOutputs(int numOutputs);
+    void setAudioCallbackStats(AudioCallbackStats const & stats, int numXRuns);
+    /* An empty status hides the progress bar. */
+    void setSpatAlgorithmBuildStatus(juce::String const & status);
     //==============================================================================
     void resized() override;
     void mouseDown(juce::MouseEvent const & event) override;
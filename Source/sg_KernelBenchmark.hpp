@@ -0,0 +1,294 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_TaggedAudioBuffer.hpp"
+#include "Data/sg_AudioStructs.hpp"
+#include "sg_AudioKernels.hpp"
+#include "sg_AudioParameters.hpp"
+#include "sg_HighpassBank.hpp"
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace gris
+{
+/* Times the speaker output stage of the audio processor on this machine.
+
+   The same noise goes through two copies of the speakers of a config : one is
+   processed like the audio processor used to, with a pass for the gain, one
+   for the highpass filter and one for the peak, and the other one with the
+   fused kernels of sg_AudioKernels.hpp. The fused highpass runs the recursion
+   of the config's filter in its own loop, and both add their own anti-denormal
+   noise, so maxDifference is expected to stay in the order of
+   kernels::DENORMAL_NOISE.
+
+   measureHighpassBank() compares the speakers that a HighpassBank takes over
+   with the same speakers going through the per-speaker kernel, the path they
+   would take without the bank. Both add their own anti-denormal noise, so
+   maxDifference is expected to stay in the order of kernels::DENORMAL_NOISE.
+
+   Can be called from any thread.
+*/
+namespace kernelBenchmark
+{
+constexpr int NUM_WARM_UP_BLOCKS = 16;
+constexpr int DEFAULT_NUM_BLOCKS = 1024;
+constexpr float GAIN = 0.7f;
+
+//==============================================================================
+struct Result {
+    // Time spent on all the speakers, per sample of a block.
+    double threePassNsPerSample{};
+    double fusedNsPerSample{};
+    // The largest difference between the two outputs, peaks included.
+    float maxDifference{};
+};
+
+//==============================================================================
+[[nodiscard]] inline Result measure(AudioConfig const & config,
+                                    int const bufferSize,
+                                    int const numBlocks = DEFAULT_NUM_BLOCKS)
+{
+    jassert(numBlocks > 0);
+
+    juce::Array<output_patch_t> speakers{};
+    for (auto const & speaker : config.speakersAudioConfig) {
+        speakers.add(speaker.key);
+    }
+
+    juce::AudioBuffer<float> noise{ 1, bufferSize };
+    juce::Random random{ 1 };
+    for (int i{}; i < bufferSize; ++i) {
+        noise.setSample(0, i, random.nextFloat() - 0.5f);
+    }
+
+    struct Path {
+        SpeakerAudioBuffer buffer{};
+        // Only the filter states are used.
+        std::unique_ptr<AudioData> audioData{ std::make_unique<AudioData>() };
+        SpeakerPeaks peaks{};
+        juce::Random randomNoise{ 1 };
+        juce::int64 ticks{};
+    };
+    Path threePass{};
+    Path fused{};
+    for (auto * path : { &threePass, &fused }) {
+        path->buffer.init(speakers);
+        path->buffer.setNumSamples(bufferSize);
+        for (auto const speaker : speakers) {
+            path->audioData->state.speakersAudioState[speaker].highpassState.resetValues();
+        }
+    }
+
+    auto const fill = [&](Path & path) {
+        for (auto const speaker : speakers) {
+            path.buffer[speaker].copyFrom(0, 0, noise, 0, 0, bufferSize);
+        }
+    };
+
+    Result result{};
+    for (int block{}; block < NUM_WARM_UP_BLOCKS + numBlocks; ++block) {
+        fill(threePass);
+        auto const threePassStart{ juce::Time::getHighResolutionTicks() };
+        for (auto const speaker : speakers) {
+            auto & buffer{ threePass.buffer[speaker] };
+            auto const & highpassConfig{ config.speakersAudioConfig[speaker].highpassConfig };
+            buffer.applyGain(0, bufferSize, GAIN);
+            if (highpassConfig) {
+                highpassConfig->process(buffer.getWritePointer(0),
+                                        bufferSize,
+                                        threePass.audioData->state.speakersAudioState[speaker].highpassState,
+                                        threePass.randomNoise);
+            }
+            threePass.peaks[speaker] = buffer.getMagnitude(0, bufferSize);
+        }
+        auto const threePassEnd{ juce::Time::getHighResolutionTicks() };
+
+        fill(fused);
+        auto const fusedStart{ juce::Time::getHighResolutionTicks() };
+        for (auto const speaker : speakers) {
+            auto * const samples{ fused.buffer[speaker].getWritePointer(0) };
+            auto const & highpassConfig{ config.speakersAudioConfig[speaker].highpassConfig };
+            if (!highpassConfig) {
+                fused.peaks[speaker] = kernels::applyGainAndGetPeak(samples, bufferSize, GAIN);
+                continue;
+            }
+            auto & highpassState{ fused.audioData->state.speakersAudioState[speaker].highpassState };
+            fused.peaks[speaker] = kernels::applyGainHighpassAndGetPeak(samples,
+                                                                        bufferSize,
+                                                                        GAIN,
+                                                                        *highpassConfig,
+                                                                        highpassState,
+                                                                        fused.randomNoise);
+        }
+        auto const fusedEnd{ juce::Time::getHighResolutionTicks() };
+
+        if (block < NUM_WARM_UP_BLOCKS) {
+            continue;
+        }
+        threePass.ticks += threePassEnd - threePassStart;
+        fused.ticks += fusedEnd - fusedStart;
+        for (auto const speaker : speakers) {
+            auto const * const expected{ threePass.buffer[speaker].getReadPointer(0) };
+            auto const * const actual{ fused.buffer[speaker].getReadPointer(0) };
+            for (int i{}; i < bufferSize; ++i) {
+                result.maxDifference = std::max(result.maxDifference, std::abs(expected[i] - actual[i]));
+            }
+            result.maxDifference
+                = std::max(result.maxDifference, std::abs(threePass.peaks[speaker] - fused.peaks[speaker]));
+        }
+    }
+
+    auto const toNsPerSample = [&](juce::int64 const ticks) {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1e9
+               / (static_cast<double>(numBlocks) * static_cast<double>(bufferSize));
+    };
+    result.threePassNsPerSample = toNsPerSample(threePass.ticks);
+    result.fusedNsPerSample = toNsPerSample(fused.ticks);
+    return result;
+}
+
+//==============================================================================
+struct BankResult {
+    // Time spent on the speakers of the bank, per sample of a block.
+    double scalarNsPerSample{};
+    double bankNsPerSample{};
+    float maxDifference{};
+    int numBankedSpeakers{};
+};
+
+/* Message thread, since it sets up AudioParameters. */
+[[nodiscard]] inline BankResult measureHighpassBank(AudioConfig const & config,
+                                                    int const bufferSize,
+                                                    double const sampleRate,
+                                                    int const numBlocks = DEFAULT_NUM_BLOCKS)
+{
+    jassert(numBlocks > 0);
+
+    BankResult result{};
+    auto const bank{ HighpassBank::make(config) };
+    if (!bank) {
+        return result;
+    }
+
+    juce::Array<output_patch_t> speakers{};
+    for (auto const & speaker : config.speakersAudioConfig) {
+        if (bank->contains(speaker.key)) {
+            speakers.add(speaker.key);
+        }
+    }
+    result.numBankedSpeakers = speakers.size();
+
+    juce::AudioBuffer<float> noise{ 1, bufferSize };
+    juce::Random random{ 1 };
+    for (int i{}; i < bufferSize; ++i) {
+        noise.setSample(0, i, random.nextFloat() - 0.5f);
+    }
+
+    struct Path {
+        SpeakerAudioBuffer buffer{};
+        std::unique_ptr<AudioData> audioData{ std::make_unique<AudioData>() };
+        std::unique_ptr<AudioParameters> parameters{ std::make_unique<AudioParameters>() };
+        SpeakerPeaks peaks{};
+        juce::Random randomNoise{ 1 };
+        juce::int64 ticks{};
+    };
+    Path scalar{};
+    Path banked{};
+    for (auto * path : { &scalar, &banked }) {
+        path->buffer.init(speakers);
+        path->buffer.setNumSamples(bufferSize);
+        path->parameters->setSampleRate(sampleRate);
+        for (auto const speaker : speakers) {
+            path->parameters->setSpeakerGain(speaker, GAIN);
+            path->audioData->state.speakersAudioState[speaker].highpassState.resetValues();
+        }
+    }
+
+    auto const fill = [&](Path & path) {
+        for (auto const speaker : speakers) {
+            path.buffer[speaker].copyFrom(0, 0, noise, 0, 0, bufferSize);
+        }
+    };
+
+    for (int block{}; block < NUM_WARM_UP_BLOCKS + numBlocks; ++block) {
+        // The same steps as AudioProcessor::processOutputModifiersAndPeaks().
+        fill(scalar);
+        auto const scalarStart{ juce::Time::getHighResolutionTicks() };
+        for (auto const speaker : speakers) {
+            auto & buffer{ scalar.buffer[speaker] };
+            auto * const samples{ buffer.getWritePointer(0) };
+            auto const gain{ scalar.parameters->applySpeakerGainRamp(speaker, samples, bufferSize) };
+            if (gain < SMALL_GAIN) {
+                buffer.clear();
+                scalar.peaks[speaker] = 0.0f;
+                continue;
+            }
+            auto const & highpassConfig{ *config.speakersAudioConfig[speaker].highpassConfig };
+            auto & highpassState{ scalar.audioData->state.speakersAudioState[speaker].highpassState };
+            scalar.peaks[speaker] = kernels::applyGainHighpassAndGetPeak(samples,
+                                                                         bufferSize,
+                                                                         gain,
+                                                                         highpassConfig,
+                                                                         highpassState,
+                                                                         scalar.randomNoise);
+        }
+        auto const scalarEnd{ juce::Time::getHighResolutionTicks() };
+
+        fill(banked);
+        auto const bankStart{ juce::Time::getHighResolutionTicks() };
+        bank->process(*banked.parameters,
+                      banked.buffer,
+                      banked.audioData->state.speakersAudioState,
+                      banked.peaks,
+                      banked.randomNoise);
+        auto const bankEnd{ juce::Time::getHighResolutionTicks() };
+
+        if (block < NUM_WARM_UP_BLOCKS) {
+            continue;
+        }
+        scalar.ticks += scalarEnd - scalarStart;
+        banked.ticks += bankEnd - bankStart;
+        for (auto const speaker : speakers) {
+            auto const * const expected{ scalar.buffer[speaker].getReadPointer(0) };
+            auto const * const actual{ banked.buffer[speaker].getReadPointer(0) };
+            for (int i{}; i < bufferSize; ++i) {
+                result.maxDifference = std::max(result.maxDifference, std::abs(expected[i] - actual[i]));
+            }
+            result.maxDifference
+                = std::max(result.maxDifference, std::abs(scalar.peaks[speaker] - banked.peaks[speaker]));
+        }
+    }
+
+    auto const toNsPerSample = [&](juce::int64 const ticks) {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1e9
+               / (static_cast<double>(numBlocks) * static_cast<double>(bufferSize));
+    };
+    result.scalarNsPerSample = toNsPerSample(scalar.ticks);
+    result.bankNsPerSample = toNsPerSample(banked.ticks);
+    return result;
+}
+
+} // namespace kernelBenchmark
+} // namespace gris
@@ -20,7 +20,6 @@
 #include "sg_MainComponent.hpp"
 
 #include "Data/sg_CommandId.hpp"
-#include "Data/sg_LegacyLbapPosition.hpp"
 #include "Data/sg_constants.hpp"
 #include "Misc/sg_DefaultFiles.hpp"
 #include "sg_AudioManager.hpp"
@@ -31,6 +30,7 @@
 #include "sg_MainWindow.hpp"
 #include "sg_ParallelSpatAlgorithm.hpp"
 #include "sg_ScopeGuard.hpp"
+#include "sg_SessionUtilities.hpp"
 #include "sg_TitledComponent.hpp"
 #include <Utilities/ValueTreeUtilities.hpp>
 #include <map>
@@ -173,6 +173,7 @@ MainContentComponent::MainContentComponent(MainWindow & mainWindow,
         // TODO : fix this.
         mControlPanel->setMulticoreDSP(mData.project.useMulticoreDSP);
         mControlPanel->setMulticoreDSPPreset(mData.project.multicoreDSPPreset);
+        mControlPanel->setMulticoreDSPAutoTuning(multicoreTuning::isEnabled());
         mControlPanel->setSpatMode(mData.project.spatMode);
         mControlPanel->setSpatMode(mData.project.spatMode);
         mControlPanel->setCubeAttenuationDb(mData.project.mbapDistanceAttenuationData.attenuation);
@@ -722,6 +723,15 @@ void MainContentComponent::handleShowPreferences()
     }
 }
 
+//==============================================================================
+void MainContentComponent::resetAudioCallbackStats()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    auto & audioManager{ AudioManager::getInstance() };
+    audioManager.getCallbackMonitor().reset(audioManager.getAudioDeviceManager().getCurrentAudioDevice());
+}
+
 //==============================================================================
 void MainContentComponent::handleShowOscMonitorWindow()
 {
@@ -955,7 +965,7 @@ void MainContentComponent::masterGainChanged(dbfs_t const gain)
     mData.project.masterGain = gain;
     mControlPanel->setMasterGain(gain);
 
-    refreshAudioProcessor();
+    refreshAudioParameters();
 }
 
 //==============================================================================
@@ -1026,7 +1036,41 @@ void MainContentComponent::setMulticoreDSPPreset(int preset)
 {
     mData.project.multicoreDSPPreset = preset;
     // no need to refresh the spat algorithm for this. It only sets worker thread waiting policy.
-    SpinSleepWait::setPerformancePreset(preset);
+    if (!multicoreTuning::isEnabled()) {
+        multicoreTuning::applyPreset(preset);
+    }
+}
+
+void MainContentComponent::setMulticoreDSPAutoTuning(bool const autoTuning)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    multicoreTuning::setEnabled(autoTuning);
+    if (!autoTuning) {
+        multicoreTuning::applyPreset(mData.project.multicoreDSPPreset);
+    } else if (!multicoreTuning::loadChoice(multicoreTuning::makeSetupKey(mData))) {
+        calibrateMulticoreDSP();
+        return;
+    }
+    refreshSpatAlgorithm();
+}
+
+//==============================================================================
+void MainContentComponent::calibrateMulticoreDSP()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedReadLock const lock{ mLock };
+
+    if (!mAudioProcessor) {
+        return;
+    }
+
+    // A calibrated setup is only used with the automatic tuning.
+    if (!multicoreTuning::isEnabled()) {
+        multicoreTuning::setEnabled(true);
+        mControlPanel->setMulticoreDSPAutoTuning(true);
+    }
+    // The audio thread keeps rendering with the current algorithm, see session::calibrate().
+    mSpatAlgorithmBuilder.calibrate(mData);
 }
 
 //==============================================================================
@@ -1162,7 +1206,7 @@ void MainContentComponent::generalMuteButtonPressed()
     mData.speakerSetup.speakerSetupValueTree.setProperty(GENERAL_MUTE, generalMute, nullptr);
     updateSpeakerSetupValueTree();
 
-    refreshAudioProcessor();
+    refreshAudioParameters();
     refreshSpeakerSlices();
 }
 
@@ -1778,7 +1822,7 @@ void MainContentComponent::audioParametersChanged()
         mData.appData.audioSettings.inputDevice = setup.inputDeviceName;
         mData.appData.audioSettings.outputDevice = setup.outputDeviceName;
 
-        AudioManager::getInstance().setBufferSize(bufferSize);
+        mAudioProcessor->setBufferSize(bufferSize);
 
         mInfoPanel->setSampleRate(sampleRate);
         mInfoPanel->setBufferSize(bufferSize);
@@ -2076,10 +2120,7 @@ void MainContentComponent::refreshSourceSlices()
     mSourcesInnerLayout->clearSections();
     mSourceSliceComponents.clear();
 
-    auto const isAtLeastOneSourceSolo{ std::any_of(
-        mData.project.sources.cbegin(),
-        mData.project.sources.cend(),
-        [](SourcesData::ConstNode const & node) { return node.value->state == SliceState::solo; }) };
+    auto const isAtLeastOneSourceSolo{ MuteSoloComponent::isSoloMode(mData.project.sources) };
 
     auto const directOutChoices{ std::make_shared<DirectOutSelectorComponent::Choices>() };
 
@@ -2118,10 +2159,7 @@ void MainContentComponent::refreshSpeakerSlices()
     mSpeakerSliceComponents.clear();
     mStereoSliceComponents.clearQuick(true);
 
-    auto const isAtLeastOneSpeakerSolo{ std::any_of(
-        mData.speakerSetup.speakers.cbegin(),
-        mData.speakerSetup.speakers.cend(),
-        [](SpeakersData::ConstNode const & node) { return node.value->state == SliceState::solo; }) };
+    auto const isAtLeastOneSpeakerSolo{ MuteSoloComponent::isSoloMode(mData.speakerSetup.speakers) };
 
     if (mData.appData.stereoMode) {
         auto const slicesState{ mData.speakerSetup.generalMute ? SliceState::muted : SliceState::normal };
@@ -2182,26 +2220,9 @@ void MainContentComponent::setLegacySourcePosition(source_index_t const sourceIn
         return;
     }
 
-    auto const getCorrectedPosition = [&]() -> Position {
-        auto const & projectSpatMode{ mData.project.spatMode };
-        auto const spatMode{ projectSpatMode == SpatMode::hybrid ? mData.project.sources[sourceIndex].hybridSpatMode
-                                                                 : projectSpatMode };
-
-        switch (spatMode) {
-        case SpatMode::vbap:
-            return Position{ PolarVector{ azimuth, elevation, 1.0f } };
-
-        case SpatMode::mbap:
-            return LegacyLbapPosition{ azimuth, elevation, length }.toPosition();
-        case SpatMode::hybrid:
-        case SpatMode::invalid:
-            break;
-        }
-        jassertfalse;
-        return {};
+    auto const correctedPosition{
+        session::correctLegacySourcePosition(mData, sourceIndex, azimuth, elevation, length)
     };
-
-    auto const correctedPosition{ getCorrectedPosition() };
     auto & source{ mData.project.sources[sourceIndex] };
 
     if (correctedPosition == source.position && juce::approximatelyEqual(newAzimuthSpan, source.azimuthSpan)
@@ -2240,20 +2261,7 @@ void MainContentComponent::setSourcePosition(source_index_t const sourceIndex,
     azimuthSpan = std::clamp(azimuthSpan, 0.0f, 1.0f);
     zenithSpan = std::clamp(zenithSpan, 0.0f, 1.0f);
 
-    auto const & projectSpatMode{ mData.project.spatMode };
-    auto const effectiveSpatMode{ projectSpatMode == SpatMode::hybrid ? source.hybridSpatMode : projectSpatMode };
-    switch (effectiveSpatMode) {
-    case SpatMode::vbap:
-        position = position.getPolar().normalized();
-        break;
-    case SpatMode::mbap:
-        position = position.getCartesian().clampedToFarField();
-        break;
-    case SpatMode::hybrid:
-    case SpatMode::invalid:
-        jassertfalse;
-        break;
-    }
+    position = session::correctSourcePosition(mData, sourceIndex, position);
 
     if (position == source.position && juce::approximatelyEqual(azimuthSpan, source.azimuthSpan)
         && juce::approximatelyEqual(zenithSpan, source.zenithSpan)) {
@@ -2283,6 +2291,30 @@ void MainContentComponent::resetSourcePosition(source_index_t const sourceIndex)
     updateSourceSpatData(sourceIndex);
 }
 
+//==============================================================================
+void MainContentComponent::setMasterGain(dbfs_t const gain)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    masterGainChanged(gain);
+}
+
+//==============================================================================
+void MainContentComponent::openProject(juce::File const & file)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    // Unsaved changes are not thrown away without asking.
+    [[maybe_unused]] auto const success{ loadProject(file, false) };
+}
+
+//==============================================================================
+void MainContentComponent::openSpeakerSetup(juce::File const & file)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    [[maybe_unused]] auto const success{
+        loadSpeakerSetup(file, LoadSpeakerSetupOption::disallowDiscardingUnsavedChanges)
+    };
+}
+
 //==============================================================================
 void MainContentComponent::projectSourceIndexChanged(source_index_t oldSourceIndex, source_index_t newSourceIndex)
 {
@@ -2373,9 +2405,13 @@ void MainContentComponent::setSpeakerGain(output_patch_t const outputPatch, dbfs
     JUCE_ASSERT_MESSAGE_THREAD;
     juce::ScopedWriteLock const lock{ mLock };
 
+    if (!mData.speakerSetup.speakers.contains(outputPatch)) {
+        return;
+    }
+
     mData.speakerSetup.speakers[outputPatch].gain = gain;
 
-    refreshAudioProcessor();
+    refreshAudioParameters();
 }
 
 //==============================================================================
@@ -2494,9 +2530,13 @@ void MainContentComponent::setSourceState(source_index_t const sourceIndex, Slic
     JUCE_ASSERT_MESSAGE_THREAD;
     juce::ScopedWriteLock const lock{ mLock };
 
+    if (!mData.project.sources.contains(sourceIndex)) {
+        return;
+    }
+
     mData.project.sources[sourceIndex].state = state;
 
-    refreshAudioProcessor();
+    refreshAudioParameters();
     refreshSourceSlices();
 }
 
@@ -2544,10 +2584,14 @@ void MainContentComponent::setSpeakerState(output_patch_t const outputPatch, Sli
     JUCE_ASSERT_MESSAGE_THREAD;
     juce::ScopedWriteLock const lock{ mLock };
 
+    if (!mData.speakerSetup.speakers.contains(outputPatch)) {
+        return;
+    }
+
     mData.speakerSetup.speakers[outputPatch].state = state;
     updateSpeakerSetupValueTree();
 
-    refreshAudioProcessor();
+    refreshAudioParameters();
     refreshSpeakerSlices();
 }
 
@@ -2579,40 +2623,86 @@ void MainContentComponent::refreshAudioProcessor() const
         return;
     }
 
-    mAudioProcessor->setAudioConfig(mData.toAudioConfig());
+    // While a build runs, the current algorithm keeps rendering and takes every config it can render. One that
+    // changes the sources, the speakers or the stereo output waits for the new algorithm : spatAlgorithmBuilt()
+    // publishes it along with it.
+    auto audioConfig{ mData.toAudioConfig() };
+    if (mSpatAlgorithmBuilder.isBuilding() && !mAudioProcessor->fitsSpatAlgorithm(*audioConfig)) {
+        return;
+    }
+    mAudioProcessor->setAudioConfig(std::move(audioConfig));
+}
+
+//==============================================================================
+void MainContentComponent::refreshAudioParameters() const
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedReadLock const lock{ mLock };
+
+    if (!mAudioProcessor) {
+        return;
+    }
+
+    auto & parameters{ mAudioProcessor->getParameters() };
+    parameters.setMasterGain(mData.project.masterGain.toGain());
+    parameters.setStereoMuted(mData.speakerSetup.generalMute);
+
+    auto const isAtLeastOneSourceSolo{ MuteSoloComponent::isSoloMode(mData.project.sources) };
+    for (auto const source : mData.project.sources) {
+        parameters.setSourceMuted(source.key,
+                                  MuteSoloComponent::isMuted(source.value->state, isAtLeastOneSourceSolo));
+    }
+
+    auto const isAtLeastOneSpeakerSolo{ MuteSoloComponent::isSoloMode(mData.speakerSetup.speakers) };
+    for (auto const speaker : mData.speakerSetup.speakers) {
+        parameters.setSpeakerGain(speaker.key, speaker.value->gain.toGain());
+        parameters.setSpeakerMuted(speaker.key,
+                                   MuteSoloComponent::isMuted(speaker.value->state, isAtLeastOneSpeakerSolo));
+    }
 }
 
 //==============================================================================
 void MainContentComponent::refreshSpatAlgorithm()
 {
     JUCE_ASSERT_MESSAGE_THREAD;
-    juce::ScopedWriteLock const lock{ mLock };
+    juce::ScopedReadLock const lock{ mLock };
 
     if (!mAudioProcessor) {
         return;
     }
 
-    juce::ScopedLock const audioLock{ mAudioProcessor->getLock() };
+    if (mAudioProcessor->getSpatAlgorithm() == nullptr) {
+        // Nothing to keep rendering with yet : the first algorithm is built right away.
+        spatAlgorithmBuilt(mSpatAlgorithmBuilder.buildNow(mData));
+        return;
+    }
 
-    auto & oldSpatAlgorithm{ mAudioProcessor->getSpatAlgorithm() };
+    // The audio thread keeps rendering with the current algorithm and config until the new algorithm is ready.
+    if (mSpatAlgorithmBuilder.build(mData)) {
+        return;
+    }
 
-    mIsRefreshingSpatAlgorithm = true;
+    // The current algorithm already fits : only the sources' positions and the config may have changed. Sources
+    // without a position are updated too, so that they are cleared from the algorithm.
+    for (auto const & source : mData.project.sources) {
+        updateSourceSpatData(source.key);
+    }
+    refreshAudioProcessor();
+}
 
-    // AbstractSpatAlgorithm::make can make a hybrid mode algorithm with multicore dsp
-    // enable but this has been benchmarked to be less performant than single core.
-    const bool shouldUseMulticoreDSP = mData.project.useMulticoreDSP && mData.project.spatMode != SpatMode::hybrid;
+//==============================================================================
+void MainContentComponent::spatAlgorithmBuilt(std::unique_ptr<AbstractSpatAlgorithm> newSpatAlgorithm)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    juce::ScopedWriteLock const lock{ mLock };
 
-    // necessary to have the right preset at project initialization.
-    SpinSleepWait::setPerformancePreset(mData.project.multicoreDSPPreset);
+    if (!mAudioProcessor) {
+        return;
+    }
 
-    auto newSpatAlgorithm{ AbstractSpatAlgorithm::make(mData.speakerSetup,
-                                                       mData.project.spatMode,
-                                                       mData.appData.stereoMode,
-                                                       mData.project.sources,
-                                                       mData.appData.audioSettings.sampleRate,
-                                                       mData.appData.audioSettings.bufferSize,
-                                                       mData.appData.binauralSettings,
-                                                       shouldUseMulticoreDSP) };
+    auto const * oldSpatAlgorithm{ mAudioProcessor->getSpatAlgorithm() };
+
+    mIsRefreshingSpatAlgorithm = true;
 
     if (mData.appData.stereoMode == StereoMode::hrtf) {
         mIsProcessingBinauralSofaFile = true;
@@ -2657,11 +2747,24 @@ void MainContentComponent::refreshSpatAlgorithm()
         }
     }
 
-    oldSpatAlgorithm = std::move(newSpatAlgorithm);
+    auto const & buildOutcome{ mSpatAlgorithmBuilder.getLastOutcome() };
+    if (buildOutcome.report.isNotEmpty()) {
+        juce::Logger::writeToLog(buildOutcome.report);
+    }
+
+    mAudioProcessor->setSpatAlgorithm(std::move(newSpatAlgorithm));
+    mAudioProcessor->setSilenceHoldSeconds(SilenceGate::getHoldSecondsFor(mData));
+    session::adopt(buildOutcome);
     mIsRefreshingSpatAlgorithm = false;
 
-    refreshAudioProcessor();
+    if (!mAudioProcessor->getSpatAlgorithm()->hasTriplets()) {
+        mData.appData.viewSettings.showSpeakerTriplets = false;
+    }
+
+    // The positions are assigned before the new config makes the audio thread switch to the new algorithm.
     reassignSourcesPositions();
+    refreshAudioProcessor();
+    refreshViewportConfig();
 }
 
 //==============================================================================
@@ -2896,7 +2999,6 @@ void MainContentComponent::removeSource(source_index_t const sourceIndex)
 {
     JUCE_ASSERT_MESSAGE_THREAD;
     juce::ScopedWriteLock const dataLock{ mLock };
-    juce::ScopedLock const audioLock{ mAudioProcessor->getLock() };
 
     mData.project.ordering.removeFirstMatchingValue(sourceIndex);
     mData.project.sources.remove(sourceIndex);
@@ -3032,7 +3134,6 @@ void MainContentComponent::removeSpeaker(output_patch_t const outputPatch, bool
 #endif
 
     juce::ScopedWriteLock const dataLock{ mLock };
-    juce::ScopedLock const audioLock{ mAudioProcessor->getLock() };
 
     mData.speakerSetup.ordering.removeFirstMatchingValue(outputPatch);
     mData.speakerSetup.speakers.remove(outputPatch);
@@ -3058,10 +3159,6 @@ void MainContentComponent::refreshSpeakers()
 
     refreshSpatAlgorithm();
 
-    if (!mAudioProcessor->getSpatAlgorithm()->hasTriplets()) {
-        mData.appData.viewSettings.showSpeakerTriplets = false;
-    }
-
     refreshSourceSlices();
     refreshSpeakerSlices();
     refreshViewportConfig();
@@ -3398,6 +3495,13 @@ void MainContentComponent::timerCallback()
         updatePeaks();
     }
 
+    if (mAudioProcessor) {
+        mAudioProcessor->collectRetired();
+    }
+    if (mInfoPanel) {
+        mInfoPanel->setSpatAlgorithmBuildStatus(mSpatAlgorithmBuilder.getStatus());
+    }
+
     auto & audioManager{ AudioManager::getInstance() };
     auto & audioDeviceManager{ audioManager.getAudioDeviceManager() };
     auto * audioDevice{ audioDeviceManager.getCurrentAudioDevice() };
@@ -3420,6 +3524,11 @@ void MainContentComponent::timerCallback()
 
     mInfoPanel->setCpuLoad(cpuRunningAverage);
 
+    auto & callbackMonitor{ audioManager.getCallbackMonitor() };
+    if (auto const * callbackStats{ callbackMonitor.getMostRecentStats() }) {
+        mInfoPanel->setAudioCallbackStats(*callbackStats, callbackMonitor.getXRunsSinceReset(*audioDevice));
+    }
+
     // TODO: could this be related to this issue https://github.com/GRIS-UdeM/SpatGRIS/issues/476 ?
     if (mIsProcessForeground != juce::Process::isForegroundProcess()) {
         mIsProcessForeground = juce::Process::isForegroundProcess();
@@ -33,12 +33,14 @@
 #include "sg_FlatViewWindow.hpp"
 #include "sg_InfoPanel.hpp"
 #include "sg_LayoutComponent.hpp"
+#include "sg_MulticoreTuning.hpp"
 #include "sg_OscInput.hpp"
 #include "sg_OscMonitor.hpp"
 #include "sg_PlayerWindow.hpp"
 #include "sg_PrepareToRecordWindow.hpp"
 #include "sg_SettingsWindow.hpp"
 #include "sg_SourceSliceComponent.hpp"
+#include "sg_SpatAlgorithmBuilder.hpp"
 #include "sg_SpatButton.hpp"
 #include "sg_SpeakerSliceComponent.hpp"
 #include "sg_SpeakerViewComponent.hpp"
@@ -69,6 +71,7 @@ class MainContentComponent final
     , public juce::ApplicationCommandTarget
     , public SourceSliceComponent::Listener
     , public SpeakerSliceComponent::Listener
+    , public OscInput::Listener
     , private SpatButton::Listener
     , private AudioDeviceManagerListener
     , private juce::Timer
@@ -80,6 +83,10 @@ class MainContentComponent final
     juce::ReadWriteLock mLock{};
 
     std::unique_ptr<AudioProcessor> mAudioProcessor{};
+    // Declared after the audio processor so that no algorithm is delivered once it is gone.
+    SpatAlgorithmBuilder mSpatAlgorithmBuilder{ [this](std::unique_ptr<AbstractSpatAlgorithm> spatAlgorithm) {
+        spatAlgorithmBuilt(std::move(spatAlgorithm));
+    } };
 
     OwnedMap<source_index_t, SourceSliceComponent, MAX_NUM_SOURCES> mSourceSliceComponents{};
     OwnedMap<output_patch_t, SpeakerSliceComponent, MAX_NUM_SPEAKERS> mSpeakerSliceComponents{};
@@ -170,10 +177,13 @@ public:
                                  radians_t elevation,
                                  float length,
                                  float newAzimuthSpan,
-                                 float newZenithSpan);
-    void setSourcePosition(source_index_t sourceIndex, Position position, float azimuthSpan, float zenithSpan);
+                                 float newZenithSpan) override;
+    void setSourcePosition(source_index_t sourceIndex, Position position, float azimuthSpan, float zenithSpan) override;
 
-    void resetSourcePosition(source_index_t sourceIndex);
+    void resetSourcePosition(source_index_t sourceIndex) override;
+    void setMasterGain(dbfs_t gain) override;
+    void openProject(juce::File const & file) override;
+    void openSpeakerSetup(juce::File const & file) override;
     void projectSourceIndexChanged(source_index_t oldSourceIndex, source_index_t newSourceIndex);
 
     void speakerDirectOutOnlyChanged(output_patch_t outputPatch, bool state);
@@ -186,7 +196,7 @@ public:
      */
     std::map<output_patch_t, tl::optional<Position>> getSpeakersGroupCenters();
 
-    void setSpeakerGain(output_patch_t outputPatch, dbfs_t gain);
+    void setSpeakerGain(output_patch_t outputPatch, dbfs_t gain) override;
     void setSpeakerHighPassFreq(output_patch_t outputPatch, hz_t freq);
     void setOscPort(int newOscPort);
     int getOscPort() const;
@@ -235,6 +245,8 @@ public:
     void setSpatMode(SpatMode const spatMode);
     void setMulticoreDSPState(bool const state);
     void setMulticoreDSPPreset(int preset);
+    void setMulticoreDSPAutoTuning(bool autoTuning);
+    void calibrateMulticoreDSP();
     void setStereoMode(tl::optional<StereoMode> stereoMode);
     void setStereoRouting(StereoRouting const & routing);
     void updateControlsSectionTitle();
@@ -299,6 +311,7 @@ public:
     //==============================================================================
     // Commands.
     void handleShowPreferences();
+    void resetAudioCallbackStats();
     void saveAsEditedSpeakerSetup();
     void saveEditedSpeakerSetup();
 
@@ -386,7 +399,9 @@ private:
     void updateSourceSpatData(source_index_t sourceIndex);
 
     void refreshAudioProcessor() const;
+    void refreshAudioParameters() const;
     void refreshSpatAlgorithm();
+    void spatAlgorithmBuilt(std::unique_ptr<AbstractSpatAlgorithm> newSpatAlgorithm);
     void updatePeaks();
     void reassignSourcesPositions();
 
@@ -0,0 +1,192 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_LogicStrucs.hpp"
+#include "sg_AbstractSpatAlgorithm.hpp"
+#include "sg_ParallelSpatAlgorithm.hpp"
+#include "sg_RendererBenchmark.hpp"
+#include "sg_SpatializationSettings.hpp"
+
+#include <JuceHeader.h>
+
+#include <atomic>
+
+namespace gris
+{
+/* Picks the multicore DSP settings on this machine instead of the operator.
+
+   Whether the parallel renderer beats a single core, and which waiting policy
+   its workers should use, depends on the cores, on the number of sources and
+   speakers and on the buffer size. Calibrating a setup times every candidate
+   with rendererBenchmark : the single core renderer, then the parallel
+   renderer with each SpinSleepWait preset. The fastest one is kept.
+
+   Calibrating is up to the operator : the settings window has a button for
+   it, enabling the automatic tuning calibrates the current setup if it never
+   was, and `--headless --calibrate` does it before the audio starts. The
+   choices are remembered per machine, for every setup that was calibrated.
+   While the automatic tuning is enabled, a setup that was never calibrated
+   uses the project's settings. Hybrid projects are never tuned : they always
+   render on a single core, see session::makeSpatAlgorithm().
+
+   tune() takes a fraction of a second per candidate and is called wherever
+   the algorithm is built, which is the SpatAlgorithmBuilder's thread for the
+   GUI. The live renderer keeps playing meanwhile and its load ends up in the
+   timings, see session::calibrate().
+
+   The SpinSleepWait preset is process-wide and read by the workers of the live
+   algorithm. tune() has to switch it to time each candidate, and puts back the
+   one given to applyPreset() when it is done : the chosen preset only takes
+   effect when its algorithm is adopted, through applyPreset(). The choices are
+   stored by the message thread, with storeChoice(), like every other write to
+   the settings.
+*/
+namespace multicoreTuning
+{
+//==============================================================================
+struct Choice {
+    bool useMulticoreDSP{};
+    int preset{ OPTIMIZE_CPU_MULTICORE_PRESET };
+};
+
+namespace detail
+{
+inline std::atomic<int> appliedPreset{ OPTIMIZE_CPU_MULTICORE_PRESET };
+} // namespace detail
+
+/* The thread that adopts the algorithms, usually the message thread. */
+inline void applyPreset(int const preset)
+{
+    detail::appliedPreset.store(preset);
+    SpinSleepWait::setPerformancePreset(preset);
+}
+
+//==============================================================================
+constexpr auto const * ENABLED_KEY = "multicoreAutoTuning";
+constexpr auto const * CHOICES_KEY = "multicoreAutoTuningChoices";
+
+//==============================================================================
+[[nodiscard]] inline bool isEnabled()
+{
+    auto const & storage{ spatializationSettings::get() };
+    return storage.getBoolValue(ENABLED_KEY);
+}
+
+/* The choices are kept either way : calibrating a setup again replaces its choice. */
+inline void setEnabled(bool const enabled)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    auto & storage{ spatializationSettings::get() };
+    storage.setValue(ENABLED_KEY, enabled);
+    storage.saveIfNeeded();
+}
+
+//==============================================================================
+/* What the timings depend on. Two setups with the same key share their calibration. */
+[[nodiscard]] inline juce::String makeSetupKey(SpatGrisData const & data)
+{
+    auto const & project{ data.project };
+    auto const & appData{ data.appData };
+
+    int numDomeSources{};
+    int numCubeSources{};
+    for (auto const & source : project.sources) {
+        auto const spatMode{ project.spatMode == SpatMode::hybrid ? source.value->hybridSpatMode : project.spatMode };
+        ++(spatMode == SpatMode::mbap ? numCubeSources : numDomeSources);
+    }
+
+    juce::String result{ spatModeToString(project.spatMode) };
+    result << "-" << numDomeSources << "d" << numCubeSources << "c-" << data.speakerSetup.speakers.size() << "s-"
+           << appData.audioSettings.bufferSize << "b-" << juce::roundToInt(appData.audioSettings.sampleRate) << "hz-"
+           << (appData.stereoMode ? static_cast<int>(*appData.stereoMode) : -1) << "st-"
+           << juce::SystemStats::getNumCpus() << "cpu";
+    return result;
+}
+
+//==============================================================================
+[[nodiscard]] inline tl::optional<Choice> loadChoice(juce::String const & setupKey)
+{
+    auto const & storage{ spatializationSettings::get() };
+    auto const choices{ storage.getXmlValue(CHOICES_KEY) };
+    if (!choices) {
+        return tl::nullopt;
+    }
+    auto const * const element{ choices->getChildByAttribute("setup", setupKey) };
+    if (!element) {
+        return tl::nullopt;
+    }
+    return Choice{ element->getBoolAttribute("multicore"),
+                   element->getIntAttribute("preset", OPTIMIZE_CPU_MULTICORE_PRESET) };
+}
+
+inline void storeChoice(juce::String const & setupKey, Choice const & choice)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    auto & storage{ spatializationSettings::get() };
+    auto choices{ storage.getXmlValue(CHOICES_KEY) };
+    if (!choices) {
+        choices = std::make_unique<juce::XmlElement>("CHOICES");
+    }
+    auto * element{ choices->getChildByAttribute("setup", setupKey) };
+    if (!element) {
+        element = choices->createNewChildElement("CHOICE");
+        element->setAttribute("setup", setupKey);
+    }
+    element->setAttribute("multicore", choice.useMulticoreDSP);
+    element->setAttribute("preset", choice.preset);
+    storage.setValue(CHOICES_KEY, choices.get());
+    storage.saveIfNeeded();
+}
+
+//==============================================================================
+/* Times every candidate for the data and returns the fastest, without applying it. The algorithms must have been built
+   from the data, one without and one with multicore DSP. If report is not null, it is set to a line describing the
+   timings. */
+[[nodiscard]] inline Choice tune(SpatGrisData const & data,
+                                 AbstractSpatAlgorithm & singleCore,
+                                 AbstractSpatAlgorithm & multicore,
+                                 juce::String * const report = nullptr)
+{
+    Choice best{};
+    auto bestNsPerSample{ rendererBenchmark::measure(singleCore, data).nsPerSample };
+    juce::String timings{ "single core " + juce::String{ bestNsPerSample, 1 } };
+
+    for (auto const preset : { OPTIMIZE_CPU_MULTICORE_PRESET, OPTIMIZE_LATENCY_MULTICORE_PRESET }) {
+        SpinSleepWait::setPerformancePreset(preset);
+        auto const nsPerSample{ rendererBenchmark::measure(multicore, data).nsPerSample };
+        timings << ", multicore preset " << preset << " " << juce::String{ nsPerSample, 1 };
+        if (nsPerSample < bestNsPerSample) {
+            bestNsPerSample = nsPerSample;
+            best = Choice{ true, preset };
+        }
+    }
+    SpinSleepWait::setPerformancePreset(detail::appliedPreset.load());
+
+    if (report) {
+        *report = "Multicore tuning on " + juce::String{ juce::SystemStats::getNumCpus() } + " cores (ns/sample): "
+                  + timings + ". Using "
+                  + (best.useMulticoreDSP ? "multicore preset " + juce::String{ best.preset } : "single core") + ".";
+    }
+    return best;
+}
+
+} // namespace multicoreTuning
+} // namespace gris
@@ -45,6 +45,12 @@ void MuteSoloComponent::setPortState(SliceState const state)
     mSoloButton.setToggleState(state == SliceState::solo);
 }
 
+//==============================================================================
+bool MuteSoloComponent::isMuted(SliceState const state, bool const soloMode) noexcept
+{
+    return soloMode ? state != SliceState::solo : state == SliceState::muted;
+}
+
 //==============================================================================
 int MuteSoloComponent::getMinWidth() const noexcept
 {
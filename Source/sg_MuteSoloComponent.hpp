@@ -23,6 +23,8 @@
 #include "sg_LayoutComponent.hpp"
 #include "sg_SmallToggleButton.hpp"
 
+#include <algorithm>
+
 namespace gris
 {
 class GrisLookAndFeel;
@@ -63,6 +65,18 @@ public:
     //==============================================================================
     void setPortState(SliceState state);
     //==============================================================================
+    /* The mute and solo rule of the sources and of the speakers : while one of them is soloed, only the soloed ones
+       are heard. The vu meters and the AudioParameters both follow it. */
+    [[nodiscard]] static bool isMuted(SliceState state, bool soloMode) noexcept;
+    /* The soloMode to give to isMuted(), for the sources or the speakers. */
+    template<typename Slices>
+    [[nodiscard]] static bool isSoloMode(Slices const & slices)
+    {
+        return std::any_of(slices.cbegin(), slices.cend(), [](auto const & node) {
+            return node.value->state == SliceState::solo;
+        });
+    }
+    //==============================================================================
     [[nodiscard]] int getMinWidth() const noexcept override;
     [[nodiscard]] int getMinHeight() const noexcept override;
     void resized() override;
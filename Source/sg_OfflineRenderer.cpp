@@ -0,0 +1,437 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_OfflineRenderer.hpp"
+
+#include "Data/sg_Narrow.hpp"
+#include "sg_SilenceGate.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace gris
+{
+//==============================================================================
+juce::String OfflineRenderer::getUsage()
+{
+    return "Usage: SpatGRIS --render --project=<file> --speakers=<file> --stems=<folder> --output=<file>\n"
+           "                        [--automation=<file>] [--stereo=<mode>] [--sofa=<file>] [--mono-files]\n"
+           "                        [--buffer-size=<samples>] [--bits=<16|24|32>] [--tail=<seconds>]\n"
+           "Stereo modes: "
+           + STEREO_MODE_STRINGS.joinIntoString(", ") + ".";
+}
+
+//==============================================================================
+tl::optional<OfflineRenderer::Options> OfflineRenderer::parseOptions(juce::ArgumentList const & arguments,
+                                                                     juce::String & error)
+{
+    auto const getFile = [&](char const * const option) -> juce::File {
+        auto const value{ arguments.getValueForOption(option).unquoted() };
+        if (value.isEmpty()) {
+            return {};
+        }
+        return juce::File::getCurrentWorkingDirectory().getChildFile(value);
+    };
+
+    Options result{};
+    result.project = getFile("--project");
+    result.speakerSetup = getFile("--speakers");
+    result.stemsFolder = getFile("--stems");
+    result.output = getFile("--output");
+    result.automation = getFile("--automation");
+    result.sofaFile = getFile("--sofa");
+    result.monoFiles = arguments.containsOption("--mono-files");
+
+    if (result.project == juce::File{} || result.speakerSetup == juce::File{} || result.stemsFolder == juce::File{}
+        || result.output == juce::File{}) {
+        error = "--project, --speakers, --stems and --output are mandatory.";
+        return tl::nullopt;
+    }
+
+    if (arguments.containsOption("--stereo")) {
+        auto const stereoModeString{ arguments.getValueForOption("--stereo") };
+        auto const index{ STEREO_MODE_STRINGS.indexOf(stereoModeString, true) };
+        if (index < 0) {
+            error = "Unknown stereo mode \"" + stereoModeString + "\".";
+            return tl::nullopt;
+        }
+        result.stereoMode = stringToStereoMode(STEREO_MODE_STRINGS[index]);
+    }
+
+    if (arguments.containsOption("--buffer-size")) {
+        result.bufferSize = arguments.getValueForOption("--buffer-size").getIntValue();
+        if (result.bufferSize <= 0 || result.bufferSize > SourceAudioBuffer::MAX_NUM_SAMPLES) {
+            error = "--buffer-size must be between 1 and " + juce::String{ SourceAudioBuffer::MAX_NUM_SAMPLES }
+                    + ".";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--bits")) {
+        result.bitsPerSample = arguments.getValueForOption("--bits").getIntValue();
+        if (result.bitsPerSample != 16 && result.bitsPerSample != 24 && result.bitsPerSample != 32) {
+            error = "--bits must be 16, 24 or 32.";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--tail")) {
+        result.tailSeconds = std::max(0.0, arguments.getValueForOption("--tail").getDoubleValue());
+    }
+
+    return result;
+}
+
+//==============================================================================
+int OfflineRenderer::run()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    juce::String error{};
+    std::atomic<int> binauralState{ -1 };
+
+    // Load the project
+    SpatGrisData data{};
+    auto project{ session::readProject(mOptions.project, error) };
+    if (!project) {
+        return fail(error);
+    }
+    auto speakerSetup{ session::readSpeakerSetup(mOptions.speakerSetup, error) };
+    if (!speakerSetup) {
+        return fail(error);
+    }
+    data.project = std::move(*project);
+    data.speakerSetup = std::move(*speakerSetup);
+    data.appData.stereoMode = mOptions.stereoMode;
+    data.appData.binauralSettings.useDefaultBinauralProfile = !mOptions.sofaFile.existsAsFile();
+    data.appData.binauralSettings.lastSofaFile = mOptions.sofaFile.getFullPathName();
+    session::reconcileSpatModes(data);
+
+    // Open the stems
+    juce::AudioFormatManager formatManager{};
+    formatManager.registerBasicFormats();
+    std::vector<Stem> stems{};
+    double sampleRate{};
+    juce::int64 numSamplesToRender{};
+    auto const files{
+        mOptions.stemsFolder.findChildFiles(juce::File::TypesOfFileToFind::findFiles, false, "*.wav;*.aif;*.aiff")
+    };
+    for (auto const & file : files) {
+        source_index_t const sourceIndex{
+            file.getFileNameWithoutExtension().fromLastOccurrenceOf("-", false, true).getIntValue()
+        };
+        if (!data.project.sources.contains(sourceIndex)) {
+            log("Ignoring \"" + file.getFileName() + "\" : source " + juce::String{ sourceIndex.get() }
+                + " is not part of the project.");
+            continue;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+        if (!reader) {
+            return fail("Unable to read \"" + file.getFullPathName() + "\".");
+        }
+        if (reader->numChannels != 1) {
+            return fail("\"" + file.getFullPathName() + "\" is not a mono file.");
+        }
+        if (sampleRate == 0.0) {
+            sampleRate = reader->sampleRate;
+        } else if (!juce::approximatelyEqual(sampleRate, reader->sampleRate)) {
+            return fail("\"" + file.getFullPathName()
+                        + "\" does not have the same sample rate as the other stems.");
+        }
+
+        numSamplesToRender = std::max(numSamplesToRender, reader->lengthInSamples);
+        stems.push_back(Stem{ std::move(reader), sourceIndex });
+    }
+    if (stems.empty()) {
+        return fail("No stem matches the project's sources in \"" + mOptions.stemsFolder.getFullPathName() + "\".");
+    }
+    numSamplesToRender += juce::roundToInt(mOptions.tailSeconds * sampleRate);
+
+    data.appData.audioSettings.sampleRate = sampleRate;
+    data.appData.audioSettings.bufferSize = mOptions.bufferSize;
+
+    // Build the spatialization algorithm
+    session::BuildOutcome buildOutcome{};
+    auto spatAlgorithm{ session::makeSpatAlgorithm(data, buildOutcome) };
+    if (buildOutcome.report.isNotEmpty()) {
+        log(buildOutcome.report);
+    }
+    session::adopt(buildOutcome);
+    if (auto const spatError{ spatAlgorithm->getError() }) {
+        return fail(session::spatAlgorithmErrorToString(*spatError));
+    }
+    if (data.appData.stereoMode == StereoMode::hrtf) {
+        spatAlgorithm->setCallback([&binauralState](int const state) { binauralState = state; });
+        static constexpr juce::uint32 SOFA_TIMEOUT_MS = 60000;
+        auto const startTime{ juce::Time::getMillisecondCounter() };
+        while (binauralState < 0 && juce::Time::getMillisecondCounter() - startTime < SOFA_TIMEOUT_MS) {
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(50);
+        }
+        if (binauralState == 1) {
+            return fail("Unable to load SOFA file \"" + mOptions.sofaFile.getFullPathName() + "\".");
+        }
+    }
+    session::assignSourcesPositions(*spatAlgorithm, data);
+    auto & spatAlgorithmRef{ *spatAlgorithm };
+
+    AudioProcessor audioProcessor{};
+    audioProcessor.setSpatAlgorithm(std::move(spatAlgorithm));
+    audioProcessor.setSilenceHoldSeconds(SilenceGate::getHoldSecondsFor(data));
+    audioProcessor.setBufferSize(mOptions.bufferSize);
+    audioProcessor.setAudioConfig(data.toAudioConfig());
+    audioProcessor.adoptPendingConfig();
+    auto & bufferBank{ *audioProcessor.getActiveBufferBank() };
+
+    // Read the automation
+    std::vector<AutomationEvent> automation{};
+    if (mOptions.automation != juce::File{}) {
+        if (!readAutomation(data, sampleRate, automation, error)) {
+            return fail(error);
+        }
+    }
+
+    // Open the output files
+    std::vector<OutputFile> outputFiles{};
+    if (!makeOutputFiles(data, bufferBank, sampleRate, outputFiles, error)) {
+        return fail(error);
+    }
+
+    // Render
+    log("Rendering " + juce::String{ static_cast<double>(numSamplesToRender) / sampleRate, 1 } + " s of audio at "
+        + juce::String{ sampleRate, 0 } + " Hz...");
+    auto const startTime{ juce::Time::getMillisecondCounterHiRes() };
+    auto nextAutomationEvent{ automation.cbegin() };
+    int lastReportedPercentage{ -1 };
+    for (juce::int64 position{}; position < numSamplesToRender; position += mOptions.bufferSize) {
+        auto const blockEnd{ position + mOptions.bufferSize };
+        for (; nextAutomationEvent != automation.cend() && nextAutomationEvent->sample < blockEnd;
+             ++nextAutomationEvent) {
+            auto & source{ data.project.sources[nextAutomationEvent->sourceIndex] };
+            source.position = nextAutomationEvent->position;
+            source.azimuthSpan = nextAutomationEvent->azimuthSpan;
+            source.zenithSpan = nextAutomationEvent->zenithSpan;
+            spatAlgorithmRef.updateSpatData(nextAutomationEvent->sourceIndex, source);
+        }
+
+        bufferBank.inputBuffer.silence();
+        bufferBank.outputBuffer.silence();
+        bufferBank.stereoBuffer.clear();
+        for (auto const & stem : stems) {
+            auto * const destination{ bufferBank.inputBuffer[stem.sourceIndex].getWritePointer(0) };
+            stem.reader->read(&destination, 1, position, mOptions.bufferSize);
+        }
+
+        audioProcessor.processAudio(bufferBank.inputBuffer,
+                                    bufferBank.outputBuffer,
+                                    bufferBank.stereoBuffer,
+                                    sampleRate);
+
+        auto const numSamplesToWrite{ narrow<int>(
+            std::min<juce::int64>(mOptions.bufferSize, numSamplesToRender - position)) };
+        for (auto const & outputFile : outputFiles) {
+            if (!outputFile.writer->writeFromFloatArrays(outputFile.channels.data(),
+                                                         outputFile.channels.size(),
+                                                         numSamplesToWrite)) {
+                return fail("Unable to write to \"" + mOptions.output.getFullPathName() + "\".");
+            }
+        }
+
+        auto const percentage{ narrow<int>(blockEnd * 100 / numSamplesToRender) };
+        if (percentage / 10 != lastReportedPercentage / 10) {
+            lastReportedPercentage = percentage;
+            log(juce::String{ std::min(percentage, 100) } + " %");
+        }
+    }
+
+    auto const elapsedSeconds{ (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0 };
+    log("Done in " + juce::String{ elapsedSeconds, 1 } + " s ("
+        + juce::String{ static_cast<double>(numSamplesToRender) / sampleRate / elapsedSeconds, 1 }
+        + "x realtime).");
+    return 0;
+}
+
+//==============================================================================
+void OfflineRenderer::log(juce::String const & message)
+{
+    std::cout << message << std::endl;
+}
+
+//==============================================================================
+int OfflineRenderer::fail(juce::String const & message)
+{
+    std::cerr << "Error: " << message << std::endl;
+    return 1;
+}
+
+//==============================================================================
+bool OfflineRenderer::readAutomation(SpatGrisData const & data,
+                                     double const sampleRate,
+                                     std::vector<AutomationEvent> & events,
+                                     juce::String & error) const
+{
+    juce::StringArray lines{};
+    if (!mOptions.automation.existsAsFile()) {
+        error = "File \"" + mOptions.automation.getFullPathName() + "\" does not exist.";
+        return false;
+    }
+    mOptions.automation.readLines(lines);
+
+    for (int lineIndex{}; lineIndex < lines.size(); ++lineIndex) {
+        auto const line{ lines[lineIndex].upToFirstOccurrenceOf("#", false, false).trim() };
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        juce::StringArray tokens{};
+        tokens.addTokens(line, " \t", "");
+        tokens.removeEmptyStrings();
+        auto const lineError{ "Line " + juce::String{ lineIndex + 1 } + " of \""
+                              + mOptions.automation.getFullPathName() + "\" : " };
+        if (tokens.size() != 6 && tokens.size() != 8) {
+            error = lineError + "expected <seconds> <car|deg|pol> <source> <a> <b> <c> [azimuthSpan zenithSpan].";
+            return false;
+        }
+
+        source_index_t const sourceIndex{ tokens[2].getIntValue() };
+        if (!data.project.sources.contains(sourceIndex)) {
+            continue;
+        }
+
+        auto const a{ tokens[3].getFloatValue() };
+        auto const b{ tokens[4].getFloatValue() };
+        auto const c{ tokens[5].getFloatValue() };
+        auto const & coordinateType{ tokens[1] };
+        Position position{};
+        if (coordinateType == "car") {
+            position = Position{ CartesianVector{ a, b, c } };
+        } else if (coordinateType == "deg") {
+            auto const azimuth{ HALF_PI - radians_t{ degrees_t{ a } } };
+            radians_t const zenith{ degrees_t{ b } };
+            position = Position{ PolarVector{ azimuth.balanced(), zenith.balanced(), c } };
+        } else if (coordinateType == "pol") {
+            auto const azimuth{ HALF_PI - radians_t{ a } };
+            radians_t const zenith{ b };
+            position = Position{ PolarVector{ azimuth.balanced(), zenith.balanced(), c } };
+        } else {
+            error = lineError + "unknown coordinate type \"" + coordinateType + "\".";
+            return false;
+        }
+
+        AutomationEvent event{};
+        event.sample = juce::roundToInt64(tokens[0].getDoubleValue() * sampleRate);
+        event.sourceIndex = sourceIndex;
+        event.position = session::correctSourcePosition(data, sourceIndex, position);
+        if (tokens.size() == 8) {
+            event.azimuthSpan = std::clamp(tokens[6].getFloatValue(), 0.0f, 1.0f);
+            event.zenithSpan = std::clamp(tokens[7].getFloatValue(), 0.0f, 1.0f);
+        }
+        events.push_back(event);
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](AutomationEvent const & lhs, AutomationEvent const & rhs) {
+        return lhs.sample < rhs.sample;
+    });
+    return true;
+}
+
+//==============================================================================
+bool OfflineRenderer::makeOutputFiles(SpatGrisData const & data,
+                                      AudioProcessor::BufferBank & bufferBank,
+                                      double const sampleRate,
+                                      std::vector<OutputFile> & outputFiles,
+                                      juce::String & error) const
+{
+    auto const & output{ mOptions.output };
+    std::unique_ptr<juce::AudioFormat> audioFormat{};
+    if (output.hasFileExtension("wav")) {
+        audioFormat = std::make_unique<juce::WavAudioFormat>();
+    } else if (output.hasFileExtension("aif;aiff")) {
+        audioFormat = std::make_unique<juce::AiffAudioFormat>();
+    } else {
+        error = "The output file must be a .wav or an .aiff file.";
+        return false;
+    }
+
+    // Same naming as AudioManager::prepareToRecord()
+    juce::StringArray suffixes{};
+    juce::Array<juce::Array<float const *>> channels{};
+    if (data.appData.stereoMode) {
+        if (mOptions.monoFiles) {
+            suffixes.add("-L");
+            suffixes.add("-R");
+            channels.add(juce::Array<float const *>{ bufferBank.stereoBuffer.getReadPointer(0) });
+            channels.add(juce::Array<float const *>{ bufferBank.stereoBuffer.getReadPointer(1) });
+        } else {
+            suffixes.add({});
+            channels.add(juce::Array<float const *>{ bufferBank.stereoBuffer.getReadPointer(0),
+                                                     bufferBank.stereoBuffer.getReadPointer(1) });
+        }
+    } else {
+        auto speakers{ data.speakerSetup.ordering };
+        speakers.sort();
+        if (mOptions.monoFiles) {
+            for (auto const outputPatch : speakers) {
+                suffixes.add("-" + juce::String{ outputPatch.get() });
+                channels.add(juce::Array<float const *>{ bufferBank.outputBuffer[outputPatch].getReadPointer(0) });
+            }
+        } else {
+            suffixes.add({});
+            channels.add(bufferBank.outputBuffer.getArrayOfReadPointers(speakers));
+        }
+    }
+
+    auto const directory{ output.getParentDirectory() };
+    if (!directory.createDirectory()) {
+        error = "Unable to create \"" + directory.getFullPathName() + "\".";
+        return false;
+    }
+
+    for (int i{}; i < suffixes.size(); ++i) {
+        auto const file{ directory.getChildFile(output.getFileNameWithoutExtension() + suffixes[i]
+                                                + output.getFileExtension()) };
+        // A FileOutputStream appends to an existing file.
+        if (file.existsAsFile() && !file.deleteFile()) {
+            error = "Unable to overwrite \"" + file.getFullPathName() + "\".";
+            return false;
+        }
+
+        std::unique_ptr<juce::OutputStream> outputStream{ file.createOutputStream() };
+        if (!outputStream) {
+            error = "Unable to create \"" + file.getFullPathName() + "\".";
+            return false;
+        }
+
+        auto writer{ audioFormat->createWriterFor(outputStream,
+                                                  juce::AudioFormatWriterOptions{}
+                                                      .withSampleRate(sampleRate)
+                                                      .withNumChannels(narrow<unsigned>(channels[i].size()))
+                                                      .withBitsPerSample(mOptions.bitsPerSample)) };
+        if (!writer) {
+            error = "Unable to write a " + juce::String{ channels[i].size() } + " channels file with "
+                    + audioFormat->getFormatName() + ".";
+            return false;
+        }
+
+        outputFiles.push_back(OutputFile{ std::move(writer), channels[i] });
+    }
+    return true;
+}
+} // namespace gris
@@ -0,0 +1,129 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_constants.hpp"
+#include "sg_AudioProcessor.hpp"
+#include "sg_SessionUtilities.hpp"
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+namespace gris
+{
+/* Renders a project to audio files as fast as the CPU allows, without an audio
+   device and without the GUI :
+
+     SpatGRIS --render --project=<file> --speakers=<file> --stems=<folder>
+              --output=<file.wav|file.aiff> [options]
+
+   The stems are mono files named like the ones loaded by the player : the
+   number after the last '-' is the source index ("piece-12.wav" feeds source
+   12). They must share the same sample rate, which becomes the rendering
+   sample rate.
+
+   The optional automation file contains one position per line :
+
+     <seconds> <car|deg|pol> <source> <a> <b> <c> [azimuthSpan zenithSpan]
+
+   The coordinates follow the /spat/serv OSC messages handled by OscInput.
+   Blank lines and everything after a '#' are ignored. Positions are applied at
+   the start of the block that contains their timestamp, which is what happens
+   to OSC messages in realtime.
+
+   The output is written like a recording : a single interleaved file, or one
+   mono file per speaker (or per stereo channel) with --mono-files.
+*/
+class OfflineRenderer
+{
+public:
+    static constexpr auto const * RENDER_OPTION = "--render";
+
+    //==============================================================================
+    struct Options {
+        juce::File project{};
+        juce::File speakerSetup{};
+        juce::File stemsFolder{};
+        juce::File output{};
+        juce::File automation{};
+        juce::File sofaFile{};
+        tl::optional<StereoMode> stereoMode{};
+        bool monoFiles{};
+        int bufferSize{ 512 };
+        int bitsPerSample{ 24 };
+        double tailSeconds{};
+    };
+
+private:
+    //==============================================================================
+    struct Stem {
+        std::unique_ptr<juce::AudioFormatReader> reader{};
+        source_index_t sourceIndex{};
+    };
+
+    struct AutomationEvent {
+        juce::int64 sample{};
+        source_index_t sourceIndex{};
+        Position position{};
+        float azimuthSpan{};
+        float zenithSpan{};
+    };
+
+    struct OutputFile {
+        std::unique_ptr<juce::AudioFormatWriter> writer{};
+        juce::Array<float const *> channels{};
+    };
+
+    //==============================================================================
+    Options mOptions{};
+
+public:
+    //==============================================================================
+    explicit OfflineRenderer(Options options) : mOptions(std::move(options)) {}
+    OfflineRenderer() = delete;
+    ~OfflineRenderer() = default;
+    SG_DELETE_COPY_AND_MOVE(OfflineRenderer)
+    //==============================================================================
+    [[nodiscard]] static juce::String getUsage();
+    [[nodiscard]] static tl::optional<Options> parseOptions(juce::ArgumentList const & arguments,
+                                                            juce::String & error);
+    /* Returns the process exit code. Runs on the message thread, which it only
+       gives back while waiting for a SOFA file to be loaded. */
+    [[nodiscard]] int run();
+
+private:
+    //==============================================================================
+    static void log(juce::String const & message);
+    [[nodiscard]] static int fail(juce::String const & message);
+    [[nodiscard]] bool readAutomation(SpatGrisData const & data,
+                                      double const sampleRate,
+                                      std::vector<AutomationEvent> & events,
+                                      juce::String & error) const;
+    [[nodiscard]] bool makeOutputFiles(SpatGrisData const & data,
+                                       AudioProcessor::BufferBank & bufferBank,
+                                       double const sampleRate,
+                                       std::vector<OutputFile> & outputFiles,
+                                       juce::String & error) const;
+
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(OfflineRenderer)
+};
+} // namespace gris
@@ -19,8 +19,6 @@
 
 #include "sg_OscInput.hpp"
 
-#include "sg_MainComponent.hpp"
-
 namespace gris
 {
 namespace
@@ -38,6 +36,21 @@ auto constexpr IS_COLOUR = [](juce::OSCArgument const & arg) -> bool { return ar
 
 juce::String const SPAT_GRIS_OSC_ADDRESS = "/spat/serv";
 
+//==============================================================================
+tl::optional<SliceState> stringToState(juce::String const & string) noexcept
+{
+    if (string == "normal") {
+        return SliceState::normal;
+    }
+    if (string == "muted") {
+        return SliceState::muted;
+    }
+    if (string == "solo") {
+        return SliceState::solo;
+    }
+    return tl::nullopt;
+}
+
 //==============================================================================
 juce::String argumentToString(juce::OSCArgument const & argument) noexcept
 {
@@ -124,7 +137,7 @@ void OscInput::processPolarRadianSourcePositionMessage(juce::OSCMessage const &
     float const radius{ message[4].getFloat32() };
 
     Position const position{ PolarVector{ azimuth.balanced(), zenith.balanced(), radius } };
-    mMainContentComponent.setSourcePosition(sourceIndex, position, azimuthSpan, zenithSpan);
+    mListener.setSourcePosition(sourceIndex, position, azimuthSpan, zenithSpan);
 }
 
 //==============================================================================
@@ -138,7 +151,7 @@ void OscInput::processPolarDegreeSourcePosition(juce::OSCMessage const & message
     float const radius{ message[4].getFloat32() };
 
     Position const position{ PolarVector{ azimuth.balanced(), zenith.balanced(), radius } };
-    mMainContentComponent.setSourcePosition(sourceIndex, position, azimuthSpan, zenithSpan);
+    mListener.setSourcePosition(sourceIndex, position, azimuthSpan, zenithSpan);
 }
 
 //==============================================================================
@@ -152,7 +165,7 @@ void OscInput::processCartesianSourcePositionMessage(juce::OSCMessage const & me
     auto const z{ message[4].getFloat32() };
 
     Position const position{ CartesianVector{ x, y, z } };
-    mMainContentComponent.setSourcePosition(sourceIndex, position, horizontalSpan, verticalSpan);
+    mListener.setSourcePosition(sourceIndex, position, horizontalSpan, verticalSpan);
 }
 
 //==============================================================================
@@ -175,7 +188,7 @@ void OscInput::processLegacySourcePositionMessage(juce::OSCMessage const & messa
 
     [[maybe_unused]] auto const gain{ message[6].getFloat32() };
 
-    mMainContentComponent.setLegacySourcePosition(*sourceIndex, azimuth, zenith, length, azimuthSpan, zenithSpan);
+    mListener.setLegacySourcePosition(*sourceIndex, azimuth, zenith, length, azimuthSpan, zenithSpan);
 }
 
 //==============================================================================
@@ -183,7 +196,7 @@ void OscInput::processSourceResetPositionMessage(juce::OSCMessage const & messag
 {
     auto const sourceIndex{ extractSourceIndex(message[1], SourceIndexBase::fromOne) };
     if (sourceIndex) {
-        mMainContentComponent.resetSourcePosition(*sourceIndex);
+        mListener.resetSourcePosition(*sourceIndex);
     }
 }
 
@@ -193,7 +206,7 @@ void OscInput::processLegacySourceResetPositionMessage(juce::OSCMessage const &
     // string "reset", int voice_to_reset.
     auto const sourceIndex{ extractSourceIndex(message[0], SourceIndexBase::fromZero) };
     if (sourceIndex) {
-        mMainContentComponent.resetSourcePosition(*sourceIndex);
+        mListener.resetSourcePosition(*sourceIndex);
     }
 }
 
@@ -230,7 +243,7 @@ void OscInput::processSourceHybridModeMessage(juce::OSCMessage const & message)
     // MessageManager::callAsync() is pretty inefficient but it's no big deal since we only call this when we want to
     // change a source's hybrid spat mode, which shouldn't be too often.
     juce::MessageManager::callAsync([this, sourceIndex = *sourceIndex, spatMode = *spatMode] {
-        this->mMainContentComponent.setSourceHybridSpatMode(sourceIndex, spatMode);
+        this->mListener.setSourceHybridSpatMode(sourceIndex, spatMode);
     });
 }
 
@@ -242,11 +255,86 @@ void OscInput::processSourceColourMessage(juce::OSCMessage const & message) cons
 
     if (sourceIndex) {
         juce::MessageManager::callAsync([this, sourceIndex = *sourceIndex, sourceColour] {
-            this->mMainContentComponent.setSourceColor(sourceIndex, sourceColour);
+            this->mListener.setSourceColor(sourceIndex, sourceColour);
         });
     }
 }
 
+//==============================================================================
+void OscInput::processSliceStateMessage(juce::OSCMessage const & message, MessageType const messageType) const noexcept
+{
+    auto const state{ stringToState(message[2].getString()) };
+    if (!state) {
+        addErrorToBuffer("unrecognized state.");
+        return;
+    }
+
+    if (messageType == MessageType::sourceState) {
+        auto const sourceIndex{ extractSourceIndex(message[1], SourceIndexBase::fromOne) };
+        if (sourceIndex) {
+            juce::MessageManager::callAsync([this, sourceIndex = *sourceIndex, state = *state] {
+                this->mListener.setSourceState(sourceIndex, state);
+            });
+        }
+        return;
+    }
+
+    auto const outputPatch{ extractOutputPatch(message[1]) };
+    if (outputPatch) {
+        juce::MessageManager::callAsync([this, outputPatch = *outputPatch, state = *state] {
+            this->mListener.setSpeakerState(outputPatch, state);
+        });
+    }
+}
+
+//==============================================================================
+void OscInput::processGainMessage(juce::OSCMessage const & message, MessageType const messageType) const noexcept
+{
+    auto const & gainArg{ message[message.size() - 1] };
+    auto const gain{ IS_INT(gainArg) ? static_cast<float>(gainArg.getInt32()) : gainArg.getFloat32() };
+    // Speakers are held to the same range as the master gain.
+    auto const clampedGain{ dbfs_t{ juce::jlimit(LEGAL_MASTER_GAIN_RANGE.getStart().get(),
+                                                 LEGAL_MASTER_GAIN_RANGE.getEnd().get(),
+                                                 gain) } };
+
+    if (messageType == MessageType::masterGain) {
+        juce::MessageManager::callAsync([this, clampedGain] { this->mListener.setMasterGain(clampedGain); });
+        return;
+    }
+
+    auto const outputPatch{ extractOutputPatch(message[1]) };
+    if (outputPatch) {
+        juce::MessageManager::callAsync([this, outputPatch = *outputPatch, clampedGain] {
+            this->mListener.setSpeakerGain(outputPatch, clampedGain);
+        });
+    }
+}
+
+//==============================================================================
+void OscInput::processOpenFileMessage(juce::OSCMessage const & message, MessageType const messageType) const noexcept
+{
+    auto const path{ message[1].getString() };
+    if (!juce::File::isAbsolutePath(path)) {
+        addErrorToBuffer("file paths should be absolute.");
+        return;
+    }
+
+    juce::File const file{ path };
+    if (!file.existsAsFile()) {
+        addErrorToBuffer("file \"" + path + "\" not found.");
+        return;
+    }
+
+    // Loading rebuilds the whole session, which only the message thread does.
+    juce::MessageManager::callAsync([this, file, messageType] {
+        if (messageType == MessageType::openProject) {
+            this->mListener.openProject(file);
+        } else {
+            this->mListener.openSpeakerSetup(file);
+        }
+    });
+}
+
 //==============================================================================
 void OscInput::addToBuffer(juce::String const & string) const
 {
@@ -349,6 +437,44 @@ OscInput::MessageType OscInput::getMessageType(juce::OSCMessage const & message)
         return MessageType::sourceColour;
     }
 
+    if (firstArg == "state" || firstArg == "spk_state") {
+        if (message.size() != 3) {
+            addErrorToBuffer("expected a state message to be exactly 3 arguments long.");
+            return MessageType::invalid;
+        }
+        if (!IS_STRING(message[2])) {
+            addErrorToBuffer("expected the 3rd argument of a state message to be a string.");
+            return MessageType::invalid;
+        }
+        return firstArg == "state" ? MessageType::sourceState : MessageType::speakerState;
+    }
+
+    if (firstArg == "gain" || firstArg == "spk_gain") {
+        auto const expectedSize{ firstArg == "gain" ? 2 : 3 };
+        if (message.size() != expectedSize) {
+            addErrorToBuffer("expected a gain message to be exactly " + juce::String{ expectedSize }
+                             + " arguments long.");
+            return MessageType::invalid;
+        }
+        if (!IS_FLOAT(message[expectedSize - 1]) && !IS_INT(message[expectedSize - 1])) {
+            addErrorToBuffer("expected the gain to be either an int or a float.");
+            return MessageType::invalid;
+        }
+        return firstArg == "gain" ? MessageType::masterGain : MessageType::speakerGain;
+    }
+
+    if (firstArg == "load_project" || firstArg == "load_speakers") {
+        if (message.size() != 2) {
+            addErrorToBuffer("expected a load message to be exactly 2 arguments long.");
+            return MessageType::invalid;
+        }
+        if (!IS_STRING(message[1])) {
+            addErrorToBuffer("expected the 2nd argument of a load message to be a string.");
+            return MessageType::invalid;
+        }
+        return firstArg == "load_project" ? MessageType::openProject : MessageType::openSpeakerSetup;
+    }
+
     addErrorToBuffer(juce::String{ "unknown command \"" } + firstArg + "\".");
     return MessageType::invalid;
 }
@@ -375,12 +501,33 @@ tl::optional<source_index_t> OscInput::extractSourceIndex(juce::OSCArgument cons
     return result;
 }
 
+//==============================================================================
+tl::optional<output_patch_t> OscInput::extractOutputPatch(juce::OSCArgument const & arg) const noexcept
+{
+    int result;
+    if (IS_INT(arg)) {
+        result = arg.getInt32();
+    } else if (IS_FLOAT(arg)) {
+        result = juce::roundToInt(arg.getFloat32());
+    } else {
+        addErrorToBuffer("output patch should be either an int or a float.");
+        return tl::nullopt;
+    }
+    if (result < 1 || result > MAX_NUM_SPEAKERS) {
+        addErrorToBuffer("output patch out of range.");
+        return tl::nullopt;
+    }
+
+    return output_patch_t{ result };
+}
+
 //==============================================================================
 void OscInput::oscMessageReceived(juce::OSCMessage const & message)
 {
     addToBuffer(messageToString(message));
 
-    switch (getMessageType(message)) {
+    auto const messageType{ getMessageType(message) };
+    switch (messageType) {
     case MessageType::legacySourcePosition:
         processLegacySourcePositionMessage(message);
         return;
@@ -399,6 +546,18 @@ void OscInput::oscMessageReceived(juce::OSCMessage const & message)
     case MessageType::sourceColour:
         processSourceColourMessage(message);
         return;
+    case MessageType::sourceState:
+    case MessageType::speakerState:
+        processSliceStateMessage(message, messageType);
+        return;
+    case MessageType::masterGain:
+    case MessageType::speakerGain:
+        processGainMessage(message, messageType);
+        return;
+    case MessageType::openProject:
+    case MessageType::openSpeakerSetup:
+        processOpenFileMessage(message, messageType);
+        return;
     case MessageType::invalid:
         break;
     }
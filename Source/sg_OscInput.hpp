@@ -21,17 +21,49 @@
 
 #include "Containers/sg_LogBuffer.hpp"
 #include "Data/StrongTypes/sg_SourceIndex.hpp"
+#include "Data/sg_LogicStrucs.hpp"
 #include "tl/optional.hpp"
 
 namespace gris
 {
-class MainContentComponent;
-
 //==============================================================================
 class OscInput final
     : private juce::OSCReceiver
     , private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
 {
+public:
+    //==============================================================================
+    /** Receives the changes requested by OSC messages. Implemented by the main component and by the headless server. */
+    class Listener
+    {
+    public:
+        Listener() = default;
+        virtual ~Listener() = default;
+        SG_DELETE_COPY_AND_MOVE(Listener)
+        //==============================================================================
+        // Called on the OSC thread.
+        virtual void setLegacySourcePosition(source_index_t sourceIndex,
+                                             radians_t azimuth,
+                                             radians_t elevation,
+                                             float length,
+                                             float newAzimuthSpan,
+                                             float newZenithSpan)
+            = 0;
+        virtual void setSourcePosition(source_index_t sourceIndex, Position position, float azimuthSpan, float zenithSpan)
+            = 0;
+        virtual void resetSourcePosition(source_index_t sourceIndex) = 0;
+        // Called on the message thread. The sources and the speakers may not exist.
+        virtual void setSourceHybridSpatMode(source_index_t sourceIndex, SpatMode spatMode) = 0;
+        virtual void setSourceColor(source_index_t sourceIndex, juce::Colour colour) = 0;
+        virtual void setSourceState(source_index_t sourceIndex, SliceState state) = 0;
+        virtual void setSpeakerState(output_patch_t outputPatch, SliceState state) = 0;
+        virtual void setMasterGain(dbfs_t gain) = 0;
+        virtual void setSpeakerGain(output_patch_t outputPatch, dbfs_t gain) = 0;
+        virtual void openProject(juce::File const & file) = 0;
+        virtual void openSpeakerSetup(juce::File const & file) = 0;
+    };
+
+private:
     enum class MessageType {
         invalid,
         sourcePosition,
@@ -39,16 +71,22 @@ class OscInput final
         sourceHybridMode,
         legacySourcePosition,
         legacyResetSourcePosition,
-        sourceColour
+        sourceColour,
+        sourceState,
+        speakerState,
+        masterGain,
+        speakerGain,
+        openProject,
+        openSpeakerSetup
     };
 
-    MainContentComponent & mMainContentComponent;
+    Listener & mListener;
     LogBuffer & mLogBuffer;
 
 public:
     //==============================================================================
-    OscInput(MainContentComponent & parent, LogBuffer & logBuffer)
-        : mMainContentComponent(parent)
+    OscInput(Listener & listener, LogBuffer & logBuffer)
+        : mListener(listener)
         , mLogBuffer(logBuffer)
     {
     }
@@ -79,12 +117,16 @@ private:
     void processLegacySourceResetPositionMessage(juce::OSCMessage const & message) const noexcept;
     void processSourceHybridModeMessage(juce::OSCMessage const & message) const noexcept;
     void processSourceColourMessage(juce::OSCMessage const & message) const noexcept;
+    void processSliceStateMessage(juce::OSCMessage const & message, MessageType messageType) const noexcept;
+    void processGainMessage(juce::OSCMessage const & message, MessageType messageType) const noexcept;
+    void processOpenFileMessage(juce::OSCMessage const & message, MessageType messageType) const noexcept;
     MessageType getMessageType(juce::OSCMessage const & message) const noexcept;
 
     enum class SourceIndexBase { fromZero, fromOne };
 
     tl::optional<source_index_t> extractSourceIndex(juce::OSCArgument const & arg,
                                                     SourceIndexBase const base) const noexcept;
+    tl::optional<output_patch_t> extractOutputPatch(juce::OSCArgument const & arg) const noexcept;
     //==============================================================================
     void addToBuffer(juce::String const & string) const;
     void addErrorToBuffer(juce::String const & string) const;
@@ -0,0 +1,164 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_TaggedAudioBuffer.hpp"
+#include "Data/sg_AudioStructs.hpp"
+#include "Data/sg_LogicStrucs.hpp"
+#include "sg_AbstractSpatAlgorithm.hpp"
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace gris
+{
+/* Times a spatialization algorithm on this machine, without an audio device.
+
+   Every source of the project is fed with noise and moved at every block, so
+   that the algorithm does all of its work : nothing is skipped for silence and
+   the gains are recomputed as often as with ControlGRIS automation. The
+   algorithm is left without any source position afterwards.
+
+   When numSilentSources is given, that many sources are fed with silence and
+   handed silentPeak instead : 0 times them the way SilenceGate leaves them
+   out, and SMALL_GAIN the way it renders them while it holds them open.
+
+   Can be called from any thread, but not while the algorithm is used by the
+   audio thread.
+*/
+namespace rendererBenchmark
+{
+constexpr int NUM_WARM_UP_BLOCKS = 16;
+constexpr int DEFAULT_NUM_BLOCKS = 128;
+
+//==============================================================================
+struct Result {
+    // Time spent in process(), per sample of a block.
+    double nsPerSample{};
+    // Time spent in updateSpatData(), per source update.
+    double nsPerUpdate{};
+};
+
+//==============================================================================
+/* Sources go around the listener, each at its own angle, a little faster at every block. */
+[[nodiscard]] inline Position
+    makeSyntheticPosition(SpatMode const spatMode, int const sourceNumber, int const numSources, int const block)
+{
+    auto const angle{ juce::MathConstants<float>::twoPi
+                      * (static_cast<float>(block) * 0.01f
+                         + static_cast<float>(sourceNumber) / static_cast<float>(std::max(numSources, 1))) };
+    if (spatMode == SpatMode::mbap) {
+        return Position{ CartesianVector{ 0.8f * std::cos(angle), 0.8f * std::sin(angle), 0.2f } };
+    }
+    return Position{ PolarVector{ radians_t{ angle }, radians_t{ 0.3f }, 1.0f } };
+}
+
+//==============================================================================
+[[nodiscard]] inline Result measure(AbstractSpatAlgorithm & spatAlgorithm,
+                                    SpatGrisData const & data,
+                                    int const numBlocks = DEFAULT_NUM_BLOCKS,
+                                    int const numSilentSources = 0,
+                                    float const silentPeak = 0.0f)
+{
+    jassert(numBlocks > 0);
+
+    auto const & sources{ data.project.sources };
+    auto const numSources{ static_cast<int>(sources.size()) };
+    auto const bufferSize{ data.appData.audioSettings.bufferSize };
+    auto const config{ data.toAudioConfig() };
+
+    juce::Array<source_index_t> sourceIndexes{};
+    for (auto const & source : sources) {
+        sourceIndexes.add(source.key);
+    }
+    juce::Array<output_patch_t> speakers{};
+    for (auto const & speaker : data.speakerSetup.speakers) {
+        speakers.add(speaker.key);
+    }
+
+    SourceAudioBuffer sourceBuffer{};
+    sourceBuffer.init(sourceIndexes);
+    sourceBuffer.setNumSamples(bufferSize);
+    SpeakerAudioBuffer speakerBuffer{};
+    speakerBuffer.init(speakers);
+    speakerBuffer.setNumSamples(bufferSize);
+    juce::AudioBuffer<float> stereoBuffer{ 2, bufferSize };
+    auto const sourcePeaks{ std::make_unique<SourcePeaks>() };
+
+    juce::Random random{ 1 };
+    for (int i{}; i < sourceIndexes.size(); ++i) {
+        auto const sourceIndex{ sourceIndexes[i] };
+        auto & buffer{ sourceBuffer[sourceIndex] };
+        if (i < numSilentSources) {
+            buffer.clear();
+            (*sourcePeaks)[sourceIndex] = silentPeak;
+            continue;
+        }
+        auto * const samples{ buffer.getWritePointer(0) };
+        for (int sample{}; sample < bufferSize; ++sample) {
+            samples[sample] = random.nextFloat() - 0.5f;
+        }
+        (*sourcePeaks)[sourceIndex] = 0.5f;
+    }
+
+    auto const getSpatMode = [&](SourceData const & source) {
+        return data.project.spatMode == SpatMode::hybrid ? source.hybridSpatMode : data.project.spatMode;
+    };
+
+    juce::int64 processTicks{};
+    juce::int64 updateTicks{};
+    for (int block{}; block < NUM_WARM_UP_BLOCKS + numBlocks; ++block) {
+        auto const updateStart{ juce::Time::getHighResolutionTicks() };
+        int sourceNumber{};
+        for (auto const & source : sources) {
+            auto movedSource{ *source.value };
+            movedSource.position = makeSyntheticPosition(getSpatMode(movedSource), sourceNumber++, numSources, block);
+            spatAlgorithm.updateSpatData(source.key, movedSource);
+        }
+
+        auto const processStart{ juce::Time::getHighResolutionTicks() };
+        speakerBuffer.silence();
+        stereoBuffer.clear();
+        spatAlgorithm.process(*config, sourceBuffer, speakerBuffer, stereoBuffer, *sourcePeaks, nullptr);
+        auto const processEnd{ juce::Time::getHighResolutionTicks() };
+
+        if (block >= NUM_WARM_UP_BLOCKS) {
+            updateTicks += processStart - updateStart;
+            processTicks += processEnd - processStart;
+        }
+    }
+
+    for (auto const & source : sources) {
+        auto clearedSource{ *source.value };
+        clearedSource.position = tl::nullopt;
+        spatAlgorithm.updateSpatData(source.key, clearedSource);
+    }
+
+    auto const toNs = [](juce::int64 const ticks) { return juce::Time::highResolutionTicksToSeconds(ticks) * 1e9; };
+    auto const numSamples{ static_cast<double>(numBlocks) * static_cast<double>(bufferSize) };
+    auto const numUpdates{ static_cast<double>(numBlocks) * static_cast<double>(std::max(numSources, 1)) };
+    return Result{ toNs(processTicks) / numSamples, toNs(updateTicks) / numUpdates };
+}
+
+} // namespace rendererBenchmark
+} // namespace gris
@@ -0,0 +1,346 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_LegacyLbapPosition.hpp"
+#include "Data/sg_LogicStrucs.hpp"
+#include "sg_AbstractSpatAlgorithm.hpp"
+#include "sg_MulticoreTuning.hpp"
+#include "sg_ParallelSpatAlgorithm.hpp"
+#include "sg_RendererBenchmark.hpp"
+#include "sg_ThreadPlacement.hpp"
+
+#include <JuceHeader.h>
+
+#include <functional>
+
+namespace gris
+{
+/* Project and speaker setup handling that does not need the GUI.
+
+   MainContentComponent reports problems with alert windows and asks the user
+   before converting a speaker setup. The command line modes cannot do either,
+   so these functions return an error message instead and always take the
+   default answer.
+*/
+namespace session
+{
+//==============================================================================
+[[nodiscard]] inline std::unique_ptr<juce::XmlElement> readXml(juce::File const & file, juce::String & error)
+{
+    if (!file.existsAsFile()) {
+        error = "File \"" + file.getFullPathName() + "\" does not exist.";
+        return nullptr;
+    }
+
+    juce::XmlDocument xmlDoc{ file };
+    auto mainXmlElem{ xmlDoc.getDocumentElement() };
+    if (!mainXmlElem) {
+        error = "File \"" + file.getFullPathName() + "\" is corrupted.\n" + xmlDoc.getLastParseError();
+    }
+    return mainXmlElem;
+}
+
+//==============================================================================
+[[nodiscard]] inline tl::optional<ProjectData> readProject(juce::File const & file, juce::String & error)
+{
+    auto const mainXmlElem{ readXml(file, error) };
+    if (!mainXmlElem) {
+        return tl::nullopt;
+    }
+
+    if (mainXmlElem->hasTagName("SpeakerSetup") || mainXmlElem->hasTagName(SpeakerSetup::XmlTags::MAIN_TAG)) {
+        error = "File \"" + file.getFullPathName() + "\" is a Speaker Setup, not a project.";
+        return tl::nullopt;
+    }
+
+    auto projectData{ ProjectData::fromXml(*mainXmlElem) };
+    if (!projectData) {
+        auto const version{ SpatGrisVersion::fromString(
+            mainXmlElem->getStringAttribute(ProjectData::XmlTags::VERSION)) };
+        error = version.compare(SPAT_GRIS_VERSION) > 0
+                    ? "File \"" + file.getFullPathName() + "\" was created using a newer version of SpatGRIS."
+                    : "File \"" + file.getFullPathName() + "\" is missing one more mandatory parameters.";
+    }
+    return projectData;
+}
+
+//==============================================================================
+[[nodiscard]] inline tl::optional<SpeakerSetup> readSpeakerSetup(juce::File const & file, juce::String & error)
+{
+    auto const mainXmlElem{ readXml(file, error) };
+    if (!mainXmlElem) {
+        return tl::nullopt;
+    }
+
+    if (mainXmlElem->hasTagName("ServerGRIS_Preset") || mainXmlElem->hasTagName(ProjectData::XmlTags::MAIN_TAG)) {
+        error = "File \"" + file.getFullPathName() + "\" is a project, not a Speaker Setup.";
+        return tl::nullopt;
+    }
+
+    auto speakerSetup{ SpeakerSetup::fromXml(*mainXmlElem) };
+    if (!speakerSetup) {
+        auto const version{ SpatGrisVersion::fromString(
+            mainXmlElem->getStringAttribute(SpeakerSetup::XmlTags::VERSION)) };
+        error = version.compare(SPAT_GRIS_VERSION) > 0
+                    ? "File \"" + file.getFullPathName() + "\" was created using a newer version of SpatGRIS."
+                    : "File \"" + file.getFullPathName() + "\" is missing one more mandatory parameters.";
+    }
+    return speakerSetup;
+}
+
+//==============================================================================
+/* What MainContentComponent::loadProject() and loadSpeakerSetup() do through
+   setSpatMode() once both files are loaded. A CUBE speaker setup used with a
+   DOME or hybrid project is converted without asking. */
+inline void reconcileSpatModes(SpatGrisData & data)
+{
+    // for project prior to SG 3.1.8 (hybrid is redirected to vbap)
+    if (data.project.spatMode == SpatMode::invalid) {
+        data.project.spatMode = data.speakerSetup.spatMode;
+    }
+
+    auto const spatMode{ data.project.spatMode };
+    if (spatMode != SpatMode::mbap && !data.speakerSetup.isDomeLike()) {
+        for (auto & node : data.speakerSetup.speakers) {
+            auto & speaker{ *node.value };
+            if (speaker.isDirectOutOnly) {
+                continue;
+            }
+            speaker.position = speaker.position.normalized();
+        }
+    }
+
+    // Speaker setup must be Dome or Cube, never Hybrid
+    data.speakerSetup.spatMode = spatMode == SpatMode::mbap ? SpatMode::mbap : SpatMode::vbap;
+
+    if (data.speakerSetup.generalMute) {
+        for (auto & speaker : data.speakerSetup.speakers) {
+            speaker.value->state = SliceState::muted;
+        }
+    }
+}
+
+//==============================================================================
+/* Builds the algorithm as asked. The SpinSleepWait preset is left alone : see BuildOutcome. */
+[[nodiscard]] inline std::unique_ptr<AbstractSpatAlgorithm> makeSpatAlgorithm(SpatGrisData const & data,
+                                                                         bool const shouldUseMulticoreDSP)
+{
+    // The workers are started by the algorithm, which gives no hook to place them : they are placed once it is built.
+    tl::optional<threadPlacement::ScopedSpawnedThreadsRole> workersRole{};
+    if (shouldUseMulticoreDSP) {
+        workersRole.emplace(threadPlacement::Role::dsp);
+    }
+
+    return AbstractSpatAlgorithm::make(data.speakerSetup,
+                                       data.project.spatMode,
+                                       data.appData.stereoMode,
+                                       data.project.sources,
+                                       data.appData.audioSettings.sampleRate,
+                                       data.appData.audioSettings.bufferSize,
+                                       data.appData.binauralSettings,
+                                       shouldUseMulticoreDSP);
+}
+
+//==============================================================================
+/* What the thread that adopts an algorithm has to do along with it, see adopt(). */
+struct BuildOutcome {
+    // A line describing what was measured, or empty.
+    juce::String report{};
+    // The SpinSleepWait preset that the workers of the algorithm should use.
+    int multicorePreset{ OPTIMIZE_CPU_MULTICORE_PRESET };
+    // A choice made by timing renderers, to remember for the setup.
+    juce::String tunedSetupKey{};
+    tl::optional<multicoreTuning::Choice> tunedChoice{};
+};
+
+/* Polled between the steps of a build : returning true gives the build up. */
+using ShouldStop = std::function<bool()>;
+
+/* Message thread, when the algorithm that came with the outcome replaces the live one. */
+inline void adopt(BuildOutcome const & outcome)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    multicoreTuning::applyPreset(outcome.multicorePreset);
+    if (outcome.tunedChoice) {
+        multicoreTuning::storeChoice(outcome.tunedSetupKey, *outcome.tunedChoice);
+    }
+}
+
+//==============================================================================
+/* Writes nothing to the settings and never changes the SpinSleepWait preset : both are left to adopt(). Nothing is
+   timed here : with the automatic tuning enabled, a setup that was never calibrated uses the project's settings until
+   the operator asks for calibrate().
+
+   Returns nullptr if shouldStop asked to give up before the algorithm was built. */
+[[nodiscard]] inline std::unique_ptr<AbstractSpatAlgorithm> makeSpatAlgorithm(SpatGrisData const & data,
+                                                                         BuildOutcome & outcome,
+                                                                         ShouldStop const & shouldStop = {})
+{
+    outcome = BuildOutcome{};
+    outcome.multicorePreset = data.project.multicoreDSPPreset;
+
+    if (shouldStop && shouldStop()) {
+        return nullptr;
+    }
+
+    // Note : AbstractSpatAlgorithm::make() can build a multicore hybrid renderer, but it runs its dome and cube halves
+    // one after the other, each with its own workers, and has been benchmarked to be less performant than single core.
+    // A renderer that partitions both source sets over one worker pool and one set of speaker buffers would have to
+    // live in AlgoGRIS, next to the parallel algorithms. Until then, hybrid projects always render on a single core.
+    // `SpatGRISBench --modes=Hybrid --multicore` times the multicore one.
+    if (data.project.spatMode == SpatMode::hybrid) {
+        return makeSpatAlgorithm(data, false);
+    }
+
+    if (multicoreTuning::isEnabled()) {
+        if (auto const choice{ multicoreTuning::loadChoice(multicoreTuning::makeSetupKey(data)) }) {
+            outcome.multicorePreset = choice->preset;
+            return makeSpatAlgorithm(data, choice->useMulticoreDSP);
+        }
+        outcome.report = "The multicore DSP was never calibrated for this setup : using the project's settings.";
+    }
+
+    return makeSpatAlgorithm(data, data.project.useMulticoreDSP);
+}
+
+//==============================================================================
+/* Builds the algorithm both without and with multicore DSP, times them with multicoreTuning::tune() and returns the
+   fastest, with the choice to remember in the outcome. Hybrid projects are not calibrated : see makeSpatAlgorithm().
+
+   Takes a fraction of a second per candidate on top of the builds. The live renderer, if any, is not paused : its
+   load ends up in the timings, which is why calibrating is left to the operator, who knows when the session is quiet.
+
+   Returns nullptr if shouldStop asked to give up. It is checked before each algorithm is built and before the
+   candidates are timed, but an algorithm that is being built cannot be interrupted. */
+[[nodiscard]] inline std::unique_ptr<AbstractSpatAlgorithm> calibrate(SpatGrisData const & data,
+                                                                 BuildOutcome & outcome,
+                                                                 ShouldStop const & shouldStop = {})
+{
+    if (data.project.spatMode == SpatMode::hybrid) {
+        return makeSpatAlgorithm(data, outcome, shouldStop);
+    }
+
+    outcome = BuildOutcome{};
+    outcome.multicorePreset = data.project.multicoreDSPPreset;
+
+    auto const isStopped = [&] { return shouldStop && shouldStop(); };
+    if (isStopped()) {
+        return nullptr;
+    }
+    auto singleCore{ makeSpatAlgorithm(data, false) };
+    if (isStopped()) {
+        return nullptr;
+    }
+    auto multicore{ makeSpatAlgorithm(data, true) };
+    if (singleCore->getError() || multicore->getError()) {
+        return singleCore;
+    }
+    if (isStopped()) {
+        return nullptr;
+    }
+
+    auto const choice{ multicoreTuning::tune(data, *singleCore, *multicore, &outcome.report) };
+    outcome.multicorePreset = choice.preset;
+    outcome.tunedSetupKey = multicoreTuning::makeSetupKey(data);
+    outcome.tunedChoice = choice;
+    return choice.useMulticoreDSP ? std::move(multicore) : std::move(singleCore);
+}
+
+//==============================================================================
+[[nodiscard]] inline juce::String spatAlgorithmErrorToString(AbstractSpatAlgorithm::Error const error)
+{
+    switch (error) {
+    case AbstractSpatAlgorithm::Error::notEnoughDomeSpeakers:
+        return "Domes need at least 3 speakers.";
+    case AbstractSpatAlgorithm::Error::notEnoughCubeSpeakers:
+        return "Cube spatialization requires at least 2 spatialized speakers.";
+    case AbstractSpatAlgorithm::Error::flatDomeSpeakersTooFarApart:
+        return "If all speakers are at the same height, Domes require their speakers not to be more than 170 degrees "
+               "apart from each others.";
+    case AbstractSpatAlgorithm::Error::failedToSpawnThreadpool:
+        return "Failed to create threadpool.";
+    }
+    jassertfalse;
+    return "Unknown error.";
+}
+
+//==============================================================================
+/* Brings a position received for a source into the space of the algorithm
+   that renders it, like MainContentComponent::setSourcePosition() does. */
+[[nodiscard]] inline Position correctSourcePosition(SpatGrisData const & data,
+                                                    source_index_t const sourceIndex,
+                                                    Position position)
+{
+    auto const & projectSpatMode{ data.project.spatMode };
+    auto const effectiveSpatMode{ projectSpatMode == SpatMode::hybrid
+                                      ? data.project.sources[sourceIndex].hybridSpatMode
+                                      : projectSpatMode };
+    switch (effectiveSpatMode) {
+    case SpatMode::vbap:
+        return Position{ position.getPolar().normalized() };
+    case SpatMode::mbap:
+        return Position{ position.getCartesian().clampedToFarField() };
+    case SpatMode::hybrid:
+    case SpatMode::invalid:
+        break;
+    }
+    jassertfalse;
+    return position;
+}
+
+//==============================================================================
+/* Same as correctSourcePosition(), for the legacy /spat/serv "pos" messages. */
+[[nodiscard]] inline Position correctLegacySourcePosition(SpatGrisData const & data,
+                                                          source_index_t const sourceIndex,
+                                                          radians_t const azimuth,
+                                                          radians_t const elevation,
+                                                          float const length)
+{
+    auto const & projectSpatMode{ data.project.spatMode };
+    auto const effectiveSpatMode{ projectSpatMode == SpatMode::hybrid
+                                      ? data.project.sources[sourceIndex].hybridSpatMode
+                                      : projectSpatMode };
+    switch (effectiveSpatMode) {
+    case SpatMode::vbap:
+        return Position{ PolarVector{ azimuth, elevation, 1.0f } };
+    case SpatMode::mbap:
+        return LegacyLbapPosition{ azimuth, elevation, length }.toPosition();
+    case SpatMode::hybrid:
+    case SpatMode::invalid:
+        break;
+    }
+    jassertfalse;
+    return {};
+}
+
+//==============================================================================
+inline void assignSourcesPositions(AbstractSpatAlgorithm & spatAlgorithm, SpatGrisData const & data)
+{
+    for (auto const & source : data.project.sources) {
+        if (!source.value->position) {
+            continue;
+        }
+        spatAlgorithm.updateSpatData(source.key, *source.value);
+    }
+}
+} // namespace session
+} // namespace gris
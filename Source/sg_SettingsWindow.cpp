@@ -22,6 +22,7 @@
 #include "sg_AudioManager.hpp"
 #include "sg_GrisLookAndFeel.hpp"
 #include "sg_JackVirtualPorts.hpp"
+#include "sg_ThreadPlacement.hpp"
 #include "sg_MainComponent.hpp"
 #include "sg_SpeakerViewComponent.hpp"
 
@@ -167,6 +168,23 @@ SettingsComponent::SettingsComponent(MainContentComponent & parent,
                    juce::String{ jackVirtualPorts::getNumOutputs() });
     mJackOutputPortsTextEditor.setInputRestrictions(3, "0123456789");
 
+    initLabel(mThreadPlacementLabel);
+    initTextEditor(mThreadPlacementTextEditor, {}, threadPlacement::loadSpec());
+    mThreadPlacementLabel.setVisible(threadPlacement::isSupported());
+    mThreadPlacementTextEditor.setVisible(threadPlacement::isSupported());
+    applyThreadPlacement();
+
+    initLabel(mMulticoreCalibrationLabel);
+    mCalibrateMulticoreButton.setButtonText("Calibrate");
+    mCalibrateMulticoreButton.setTooltip(
+        "Times the single core and the multicore DSP with the current setup and uses the fastest from now on. "
+        "The audio keeps playing, so the timings are cleaner when nothing else runs.");
+    mCalibrateMulticoreButton.setBounds(0, 0, RIGHT_COL_WIDTH / 2, COMPONENT_HEIGHT);
+    mCalibrateMulticoreButton.addListener(this);
+    mCalibrateMulticoreButton.setColour(juce::ToggleButton::textColourId, mLookAndFeel.getFontColour());
+    mCalibrateMulticoreButton.setLookAndFeel(&mLookAndFeel);
+    addAndMakeVisible(mCalibrateMulticoreButton);
+
     //==============================================================================
     initSectionLabel(mSpatNetworkSettings);
 
@@ -273,6 +291,8 @@ void SettingsComponent::buttonClicked(juce::Button * button)
         if (isSelectedAudioDeviceActive()) {
             mMainContentComponent.closePropertiesWindow();
         }
+    } else if (button == &mCalibrateMulticoreButton) {
+        mMainContentComponent.calibrateMulticoreDSP();
     }
 }
 
@@ -315,6 +335,14 @@ void SettingsComponent::placeComponents()
         mJackOutputPortsLabel.setTopLeftPosition(LEFT_COL_START, yPosition);
         mJackOutputPortsTextEditor.setTopLeftPosition(RIGHT_COL_START, yPosition);
     }
+    if (threadPlacement::isSupported()) {
+        addLineGap();
+        mThreadPlacementLabel.setTopLeftPosition(LEFT_COL_START, yPosition);
+        mThreadPlacementTextEditor.setTopLeftPosition(RIGHT_COL_START, yPosition);
+    }
+    addLineGap();
+    mMulticoreCalibrationLabel.setTopLeftPosition(LEFT_COL_START, yPosition);
+    mCalibrateMulticoreButton.setTopLeftPosition(RIGHT_COL_START, yPosition);
     addSectionGap();
 
     //==============================================================================
@@ -447,6 +475,25 @@ void SettingsComponent::updateJackVirtualPortControls()
     }
 }
 
+//==============================================================================
+void SettingsComponent::applyThreadPlacement()
+{
+    static constexpr auto const * SYNTAX{
+        "CPUs and SCHED_FIFO priorities of the threads, applied the next time SpatGRIS starts. "
+        "Example : audio=2-3:80 dsp=4-15:70 disk=16-17 ui=0-1 mlockall"
+    };
+
+    auto const spec{ mThreadPlacementTextEditor.getText().trim() };
+    juce::String error{};
+    if (!threadPlacement::parse(spec, error)) {
+        mThreadPlacementTextEditor.setText(threadPlacement::loadSpec(), false);
+        mThreadPlacementTextEditor.setTooltip(error + "\n" + SYNTAX);
+        return;
+    }
+    threadPlacement::storeSpec(spec);
+    mThreadPlacementTextEditor.setTooltip(SYNTAX);
+}
+
 //==============================================================================
 void SettingsComponent::applyJackVirtualPortCounts()
 {
@@ -572,6 +619,8 @@ void SettingsComponent::textEditorReturnKeyPressed(juce::TextEditor & textEditor
 {
     if (&textEditor == &mJackInputPortsTextEditor || &textEditor == &mJackOutputPortsTextEditor) {
         applyJackVirtualPortCounts();
+    } else if (&textEditor == &mThreadPlacementTextEditor) {
+        applyThreadPlacement();
     }
 }
 
@@ -581,6 +630,10 @@ void SettingsComponent::textEditorFocusLost(juce::TextEditor & textEditor)
         applyJackVirtualPortCounts();
         return;
     }
+    if (&textEditor == &mThreadPlacementTextEditor) {
+        applyThreadPlacement();
+        return;
+    }
 
     if (&textEditor == &mSpeakerViewOutputAddressTextEditor && textEditor.getText() != "") {
         // Validate IP address (thanks
@@ -83,6 +83,14 @@ class SettingsComponent final
     juce::Label mJackOutputPortsLabel{ "", "JACK output ports :" };
     juce::TextEditor mJackOutputPortsTextEditor{};
 
+    // Shown only on Linux. See sg_ThreadPlacement.hpp.
+    juce::Label mThreadPlacementLabel{ "", "Thread placement :" };
+    juce::TextEditor mThreadPlacementTextEditor{};
+
+    // See sg_MulticoreTuning.hpp.
+    juce::Label mMulticoreCalibrationLabel{ "", "Multicore DSP :" };
+    juce::TextButton mCalibrateMulticoreButton{};
+
     //==============================================================================
     juce::Label mSpatNetworkSettings{ "", "Spatialization Data Network Settings" };
 
@@ -139,6 +147,7 @@ private:
     [[nodiscard]] bool shouldShowJackVirtualPortControls() const;
     void updateJackVirtualPortControls();
     void applyJackVirtualPortCounts();
+    void applyThreadPlacement();
     //==============================================================================
     JUCE_LEAK_DETECTOR(SettingsComponent)
 public:
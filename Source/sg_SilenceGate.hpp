@@ -0,0 +1,159 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Containers/sg_StrongArray.hpp"
+#include "Data/sg_AudioStructs.hpp"
+#include "Data/sg_LogicStrucs.hpp"
+#include "Data/sg_Macros.hpp"
+#include "Data/sg_constants.hpp"
+#include "sg_AudioParameters.hpp"
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace gris
+{
+/* Decides which sources the spatialization algorithm can leave out.
+
+   The algorithms skip the sources whose peak is below SMALL_GAIN, and muted
+   sources are handed a peak of 0 once AudioParameters has faded them out. For
+   most renderers this is all there is to it : a quiet source has nothing left
+   to render, so the gate passes the peaks through and only counts the skipped
+   sources for the info panel.
+
+   The HRTF reduction is the exception : its convolution keeps ringing after
+   its input stops, and skipping the source at once cuts that tail. When a hold
+   time is set, a source that goes quiet is kept open for that long, with a
+   peak of SMALL_GAIN, so that the renderer finishes its tail. The hold is set
+   for the renderer in use with setHoldSeconds(), see getHoldSecondsFor(). It
+   is extra work compared to skipping at once : the held sources are counted
+   apart from the skipped ones, and SpatGRISBench reports what rendering the
+   silent sources costs (see rendererBenchmark::measure()).
+
+   The peaks published to the meters are not affected.
+*/
+class SilenceGate
+{
+public:
+    // Long enough for the HRTF impulse responses to die out.
+    static constexpr double HRTF_HOLD_SECONDS = 0.1;
+
+private:
+    //==============================================================================
+    // Any thread -> audio thread.
+    std::atomic<double> mHoldSeconds{};
+    // Audio thread only.
+    SourcePeaks mGatedPeaks{};
+    // Number of samples since each source was last above SMALL_GAIN, saturated at the hold time.
+    StrongArray<source_index_t, int, MAX_NUM_SOURCES> mSilentSamples{};
+    int mNumSources{};
+    int mNumSkippedSources{};
+    int mNumHeldSources{};
+
+public:
+    //==============================================================================
+    SilenceGate() = default;
+    ~SilenceGate() = default;
+    SG_DELETE_COPY_AND_MOVE(SilenceGate)
+    //==============================================================================
+    /* The hold that the renderers of the data need : 0 unless the stereo reduction is the HRTF one. */
+    [[nodiscard]] static double getHoldSecondsFor(SpatGrisData const & data) noexcept
+    {
+        return data.appData.stereoMode == StereoMode::hrtf ? HRTF_HOLD_SECONDS : 0.0;
+    }
+
+    /* Any thread. 0 skips the quiet sources at once. */
+    void setHoldSeconds(double const holdSeconds) noexcept
+    {
+        jassert(holdSeconds >= 0.0);
+        mHoldSeconds.store(holdSeconds, std::memory_order_relaxed);
+    }
+    [[nodiscard]] double getHoldSeconds() const noexcept { return mHoldSeconds.load(std::memory_order_relaxed); }
+
+    //==============================================================================
+    /* Audio thread. Returns the peaks to hand to the spatialization algorithm. */
+    [[nodiscard]] SourcePeaks const & process(AudioConfig const & config,
+                                              AudioParameters const & parameters,
+                                              SourcePeaks const & peaks,
+                                              int const numSamples,
+                                              double const sampleRate) noexcept
+    {
+        auto const holdSamples{ static_cast<int>(getHoldSeconds() * sampleRate) };
+
+        mNumSources = 0;
+        mNumSkippedSources = 0;
+        mNumHeldSources = 0;
+        for (auto const & source : config.sourcesAudioConfig) {
+            auto const sourceIndex{ source.key };
+            auto const peak{ peaks[sourceIndex] };
+            auto & silentSamples{ mSilentSamples[sourceIndex] };
+            ++mNumSources;
+
+            if (parameters.isSourceFadedOut(sourceIndex)) {
+                silentSamples = holdSamples;
+                mGatedPeaks[sourceIndex] = 0.0f;
+                ++mNumSkippedSources;
+                continue;
+            }
+
+            if (peak >= SMALL_GAIN) {
+                silentSamples = 0;
+                mGatedPeaks[sourceIndex] = peak;
+                continue;
+            }
+
+            silentSamples = std::min(silentSamples + numSamples, holdSamples);
+            if (silentSamples < holdSamples) {
+                mGatedPeaks[sourceIndex] = SMALL_GAIN;
+                ++mNumHeldSources;
+                continue;
+            }
+
+            mGatedPeaks[sourceIndex] = peak;
+            ++mNumSkippedSources;
+        }
+
+        return mGatedPeaks;
+    }
+
+    /* Audio thread. The sources of the config the gate last processed. */
+    [[nodiscard]] int getNumSources() const noexcept { return mNumSources; }
+    /* Audio thread. The sources the spatialization algorithm skipped in the last block, because they were quiet or
+       muted. */
+    [[nodiscard]] int getNumSkippedSources() const noexcept { return mNumSkippedSources; }
+    /* Audio thread. The quiet sources that were rendered anyway in the last block, to finish their tail. */
+    [[nodiscard]] int getNumHeldSources() const noexcept { return mNumHeldSources; }
+
+    /* Audio thread. For blocks that are not spatialized. */
+    void clearCounts() noexcept
+    {
+        mNumSources = 0;
+        mNumSkippedSources = 0;
+        mNumHeldSources = 0;
+    }
+
+private:
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(SilenceGate)
+};
+} // namespace gris
@@ -0,0 +1,157 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_SimulatedAudioDevice.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace gris
+{
+//==============================================================================
+juce::String SimulatedAudioIODevice::open(juce::BigInteger const & inputChannels,
+                                          juce::BigInteger const & outputChannels,
+                                          double const sampleRate,
+                                          int const bufferSizeSamples)
+{
+    close();
+
+    mActiveInputs = inputChannels;
+    mActiveInputs.setRange(MAX_NUM_SOURCES, mActiveInputs.getHighestBit() + 1, false);
+    mActiveOutputs = outputChannels;
+    mActiveOutputs.setRange(MAX_NUM_SPEAKERS, mActiveOutputs.getHighestBit() + 1, false);
+    mSampleRate = sampleRate > 0.0 ? sampleRate : 48000.0;
+    mBufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : getDefaultBufferSize();
+
+    mInputBuffer.setSize(std::max(1, mActiveInputs.countNumberOfSetBits()), mBufferSize);
+    juce::Random random{ 1 };
+    for (int channel{}; channel < mInputBuffer.getNumChannels(); ++channel) {
+        auto * const samples{ mInputBuffer.getWritePointer(channel) };
+        for (int i{}; i < mBufferSize; ++i) {
+            samples[i] = (random.nextFloat() - 0.5f) * 0.01f;
+        }
+    }
+    mOutputBuffer.setSize(std::max(1, mActiveOutputs.countNumberOfSetBits()), mBufferSize);
+
+    mXRunCount.store(0);
+    mIsOpen = true;
+    return {};
+}
+
+//==============================================================================
+void SimulatedAudioIODevice::close()
+{
+    stop();
+    mIsOpen = false;
+}
+
+//==============================================================================
+void SimulatedAudioIODevice::start(juce::AudioIODeviceCallback * callback)
+{
+    if (!mIsOpen || callback == nullptr) {
+        return;
+    }
+    stop();
+
+    callback->audioDeviceAboutToStart(this);
+    {
+        juce::ScopedLock const lock{ mCallbackLock };
+        mCallback = callback;
+    }
+    startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(9));
+}
+
+//==============================================================================
+void SimulatedAudioIODevice::stop()
+{
+    stopThread(-1);
+
+    juce::AudioIODeviceCallback * previousCallback{};
+    {
+        juce::ScopedLock const lock{ mCallbackLock };
+        previousCallback = std::exchange(mCallback, nullptr);
+    }
+    if (previousCallback) {
+        previousCallback->audioDeviceStopped();
+    }
+}
+
+//==============================================================================
+juce::StringArray SimulatedAudioIODevice::makeChannelNames(int const count)
+{
+    juce::StringArray result{};
+    for (int i{ 1 }; i <= count; ++i) {
+        result.add("Channel " + juce::String{ i });
+    }
+    return result;
+}
+
+//==============================================================================
+void SimulatedAudioIODevice::run()
+{
+    using clock = std::chrono::steady_clock;
+    auto const blockDuration{ std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>{ static_cast<double>(mBufferSize) / mSampleRate }) };
+
+    juce::Array<float const *> inputs{};
+    for (int channel{}; channel < mActiveInputs.countNumberOfSetBits(); ++channel) {
+        inputs.add(mInputBuffer.getReadPointer(channel));
+    }
+    juce::Array<float *> outputs{};
+    for (int channel{}; channel < mActiveOutputs.countNumberOfSetBits(); ++channel) {
+        outputs.add(mOutputBuffer.getWritePointer(channel));
+    }
+
+    auto deadline{ clock::now() + blockDuration };
+    while (!threadShouldExit()) {
+        std::this_thread::sleep_until(deadline);
+
+        {
+            juce::ScopedLock const lock{ mCallbackLock };
+            if (mCallback) {
+                mCallback->audioDeviceIOCallbackWithContext(inputs.data(),
+                                                            inputs.size(),
+                                                            outputs.data(),
+                                                            outputs.size(),
+                                                            mBufferSize,
+                                                            {});
+            }
+        }
+
+        deadline += blockDuration;
+        auto const now{ clock::now() };
+        if (now > deadline) {
+            // The next block is already late : drop it.
+            mXRunCount.fetch_add(1, std::memory_order_relaxed);
+            deadline = now + blockDuration;
+        }
+    }
+}
+
+//==============================================================================
+juce::AudioIODevice * SimulatedAudioIODeviceType::createDevice(juce::String const & outputDeviceName,
+                                                               juce::String const & inputDeviceName)
+{
+    if (outputDeviceName != SimulatedAudioIODevice::DEVICE_NAME
+        && inputDeviceName != SimulatedAudioIODevice::DEVICE_NAME) {
+        return nullptr;
+    }
+    return new SimulatedAudioIODevice{};
+}
+} // namespace gris
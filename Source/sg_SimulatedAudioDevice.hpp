@@ -0,0 +1,143 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_Macros.hpp"
+#include "Data/sg_constants.hpp"
+
+#include <JuceHeader.h>
+
+#include <atomic>
+
+namespace gris
+{
+/* An audio device without any hardware behind it, for machines without a
+   sound card and for soak tests.
+
+   Its thread calls the audio callback at the pace of the chosen sample rate
+   and buffer size, like the driver of a real device would. The inputs carry
+   a quiet noise, so that no source is left out as silent, and the outputs go
+   nowhere.
+
+   A callback that runs past the start of the next block makes the device miss
+   that block : it is counted as an xrun and the clock starts again from the
+   end of the late callback, which is what a real device does when it drops
+   a period.
+
+   Listed as the "Simulated" device type next to the ones found by JUCE, but
+   only when AudioManager::init() is asked to : by --simulated and --soak.
+*/
+class SimulatedAudioIODevice final
+    : public juce::AudioIODevice
+    , private juce::Thread
+{
+public:
+    static constexpr auto const * TYPE_NAME = "Simulated";
+    static constexpr auto const * DEVICE_NAME = "Simulated device";
+
+private:
+    //==============================================================================
+    juce::BigInteger mActiveInputs{};
+    juce::BigInteger mActiveOutputs{};
+    double mSampleRate{ 48000.0 };
+    int mBufferSize{ 512 };
+    bool mIsOpen{};
+    juce::AudioBuffer<float> mInputBuffer{};
+    juce::AudioBuffer<float> mOutputBuffer{};
+    juce::CriticalSection mCallbackLock{};
+    juce::AudioIODeviceCallback * mCallback{};
+    std::atomic<int> mXRunCount{};
+
+public:
+    //==============================================================================
+    SimulatedAudioIODevice() : juce::AudioIODevice(DEVICE_NAME, TYPE_NAME), juce::Thread("Simulated audio device") {}
+    ~SimulatedAudioIODevice() override { close(); }
+    SG_DELETE_COPY_AND_MOVE(SimulatedAudioIODevice)
+    //==============================================================================
+    [[nodiscard]] juce::StringArray getOutputChannelNames() override { return makeChannelNames(MAX_NUM_SPEAKERS); }
+    [[nodiscard]] juce::StringArray getInputChannelNames() override { return makeChannelNames(MAX_NUM_SOURCES); }
+    [[nodiscard]] juce::Array<double> getAvailableSampleRates() override
+    {
+        return { 44100.0, 48000.0, 88200.0, 96000.0 };
+    }
+    [[nodiscard]] juce::Array<int> getAvailableBufferSizes() override { return { 32, 64, 128, 256, 512, 1024, 2048 }; }
+    [[nodiscard]] int getDefaultBufferSize() override { return 512; }
+
+    //==============================================================================
+    juce::String open(juce::BigInteger const & inputChannels,
+                      juce::BigInteger const & outputChannels,
+                      double sampleRate,
+                      int bufferSizeSamples) override;
+    void close() override;
+    [[nodiscard]] bool isOpen() override { return mIsOpen; }
+
+    //==============================================================================
+    void start(juce::AudioIODeviceCallback * callback) override;
+    void stop() override;
+
+    [[nodiscard]] bool isPlaying() override { return isThreadRunning(); }
+    [[nodiscard]] juce::String getLastError() override { return {}; }
+
+    //==============================================================================
+    [[nodiscard]] int getCurrentBufferSizeSamples() override { return mBufferSize; }
+    [[nodiscard]] double getCurrentSampleRate() override { return mSampleRate; }
+    [[nodiscard]] int getCurrentBitDepth() override { return 32; }
+    [[nodiscard]] juce::BigInteger getActiveOutputChannels() const override { return mActiveOutputs; }
+    [[nodiscard]] juce::BigInteger getActiveInputChannels() const override { return mActiveInputs; }
+    [[nodiscard]] int getOutputLatencyInSamples() override { return mBufferSize; }
+    [[nodiscard]] int getInputLatencyInSamples() override { return mBufferSize; }
+    [[nodiscard]] int getXRunCount() const noexcept override { return mXRunCount.load(); }
+
+private:
+    //==============================================================================
+    [[nodiscard]] static juce::StringArray makeChannelNames(int count);
+
+    //==============================================================================
+    void run() override;
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(SimulatedAudioIODevice)
+};
+
+//==============================================================================
+class SimulatedAudioIODeviceType final : public juce::AudioIODeviceType
+{
+public:
+    //==============================================================================
+    SimulatedAudioIODeviceType() : juce::AudioIODeviceType(SimulatedAudioIODevice::TYPE_NAME) {}
+    ~SimulatedAudioIODeviceType() override = default;
+    SG_DELETE_COPY_AND_MOVE(SimulatedAudioIODeviceType)
+    //==============================================================================
+    void scanForDevices() override {}
+    [[nodiscard]] juce::StringArray getDeviceNames(bool /*wantInputNames*/) const override
+    {
+        return { SimulatedAudioIODevice::DEVICE_NAME };
+    }
+    [[nodiscard]] int getDefaultDeviceIndex(bool /*forInput*/) const override { return 0; }
+    [[nodiscard]] int getIndexOfDevice(juce::AudioIODevice * device, bool /*asInput*/) const override
+    {
+        return device == nullptr ? -1 : 0;
+    }
+    [[nodiscard]] bool hasSeparateInputsAndOutputs() const override { return false; }
+    [[nodiscard]] juce::AudioIODevice * createDevice(juce::String const & outputDeviceName,
+                                                     juce::String const & inputDeviceName) override;
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(SimulatedAudioIODeviceType)
+};
+} // namespace gris
@@ -0,0 +1,330 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_SoakTest.hpp"
+
+#include "sg_AudioManager.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+namespace gris
+{
+//==============================================================================
+void SoakTest::LoadGenerator::run()
+{
+    juce::OSCSender sender{};
+    if (!sender.connect("127.0.0.1", mOscPort)) {
+        std::cerr << "Error: the load generator is unable to reach port " << mOscPort << "." << std::endl;
+        return;
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto const tickDuration{ std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>{ 1.0 / mRateHz }) };
+    auto const start{ clock::now() };
+    auto deadline{ start };
+
+    while (!threadShouldExit()) {
+        auto const seconds{ std::chrono::duration<float>{ clock::now() - start }.count() };
+        for (int i{}; i < mNumSources; ++i) {
+            // Every source turns once every ten seconds, each at its own angle and height.
+            auto const turn{ seconds * 0.1f + static_cast<float>(i) / static_cast<float>(mNumSources) };
+            auto const azimuth{ 360.0f * (turn - std::floor(turn)) };
+            auto const elevation{ 45.0f + 30.0f * std::sin(juce::MathConstants<float>::twoPi * turn) };
+            juce::OSCMessage message{ juce::OSCAddressPattern{ "/spat/serv" } };
+            message.addString("deg");
+            message.addInt32(i + 1);
+            message.addFloat32(azimuth);
+            message.addFloat32(elevation);
+            message.addFloat32(1.0f);
+            message.addFloat32(0.0f);
+            message.addFloat32(0.0f);
+            (sender.send(message) ? mNumSent : mNumFailed).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        deadline += tickDuration;
+        auto const now{ clock::now() };
+        if (now > deadline) {
+            mNumLateTicks.fetch_add(1, std::memory_order_relaxed);
+            deadline = now;
+            continue;
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+//==============================================================================
+SoakTest::~SoakTest()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    stopTimer();
+    // The generator must not outlive the server it sends to.
+    mLoadGenerator.reset();
+    mServer.reset();
+}
+
+//==============================================================================
+juce::String SoakTest::getUsage()
+{
+    return "Usage: SpatGRIS --soak [--duration=<seconds>[s|m|h]] [--sources=<count>] [--rate=<hz>]\n"
+           "                      [--report-interval=<seconds>] [--output=<file>] [--real-device]\n"
+           "                      [--project=<file>] [--speakers=<file>] [--osc-port=<port>]\n"
+           "                      [--sample-rate=<hz>] [--buffer-size=<samples>]";
+}
+
+//==============================================================================
+tl::optional<SoakTest::Options> SoakTest::parseOptions(juce::ArgumentList const & arguments,
+                                                       juce::String & error)
+{
+    auto const serverOptions{ HeadlessServer::parseOptions(arguments, error) };
+    if (!serverOptions) {
+        return tl::nullopt;
+    }
+
+    Options result{};
+    result.server = *serverOptions;
+    result.server.simulatedDevice = !arguments.containsOption("--real-device");
+    result.server.oscPort = result.server.oscPort.value_or(DEFAULT_OSC_PORT);
+
+    if (arguments.containsOption("--duration")) {
+        auto const value{ arguments.getValueForOption("--duration").trim() };
+        auto const unit{ value.getLastCharacter() };
+        auto const multiplier{ unit == 'h' ? 3600.0 : unit == 'm' ? 60.0 : 1.0 };
+        auto const number{ unit == 'h' || unit == 'm' || unit == 's' ? value.dropLastCharacters(1) : value };
+        result.durationSeconds = number.getDoubleValue() * multiplier;
+        if (!number.containsOnly("0123456789.") || result.durationSeconds <= 0.0) {
+            error = "--duration must be a positive number of seconds, minutes (m) or hours (h).";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--sources")) {
+        result.numSources = arguments.getValueForOption("--sources").getIntValue();
+        if (result.numSources < 1 || result.numSources > MAX_NUM_SOURCES) {
+            error = "--sources must be between 1 and " + juce::String{ MAX_NUM_SOURCES } + ".";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--rate")) {
+        result.rateHz = arguments.getValueForOption("--rate").getDoubleValue();
+        if (result.rateHz <= 0.0 || result.rateHz > 10000.0) {
+            error = "--rate must be between 0 and 10000 messages per second and per source.";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--report-interval")) {
+        result.reportIntervalSeconds = arguments.getValueForOption("--report-interval").getIntValue();
+        if (result.reportIntervalSeconds < 1) {
+            error = "--report-interval must be at least 1 second.";
+            return tl::nullopt;
+        }
+    }
+
+    if (arguments.containsOption("--output")) {
+        result.output
+            = juce::File::getCurrentWorkingDirectory().getChildFile(arguments.getValueForOption("--output"));
+    }
+
+    return result;
+}
+
+//==============================================================================
+bool SoakTest::start(juce::String & error)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    mServer = std::make_unique<HeadlessServer>(mOptions.server);
+    if (!mServer->start(error)) {
+        return false;
+    }
+
+    auto const numProjectSources{ mServer->getNumSources() };
+    auto const numSources{ mOptions.numSources == 0 ? numProjectSources : mOptions.numSources };
+    if (numSources > numProjectSources) {
+        std::cerr << "Warning: the project only has " << numProjectSources << " sources, the other "
+                  << numSources - numProjectSources << " will be ignored by the server." << std::endl;
+    }
+    std::cerr << "Soak test: " << numSources << " sources at " << mOptions.rateHz << " Hz for "
+              << mOptions.durationSeconds << " seconds." << std::endl;
+
+    // Replaces the handlers of the server, which would quit without a summary.
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    getCallbackMonitor().reset(getAudioDevice());
+    mLoadGenerator = std::make_unique<LoadGenerator>(*mOptions.server.oscPort, numSources, mOptions.rateHz);
+    mLoadGenerator->startThread();
+    mStartTicks = juce::Time::getHighResolutionTicks();
+    startTimer(TIMER_INTERVAL_MS);
+    return true;
+}
+
+//==============================================================================
+AudioCallbackMonitor & SoakTest::getCallbackMonitor()
+{
+    return AudioManager::getInstance().getCallbackMonitor();
+}
+
+//==============================================================================
+juce::AudioIODevice * SoakTest::getAudioDevice()
+{
+    return AudioManager::getInstance().getAudioDeviceManager().getCurrentAudioDevice();
+}
+
+//==============================================================================
+double SoakTest::getElapsedSeconds() const
+{
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - mStartTicks);
+}
+
+//==============================================================================
+void SoakTest::timerCallback()
+{
+    auto const elapsedSeconds{ getElapsedSeconds() };
+    auto const isDone{ mStopRequested.exchange(false) || elapsedSeconds >= mOptions.durationSeconds };
+
+    if (isDone || elapsedSeconds - mLastReportSeconds >= mOptions.reportIntervalSeconds) {
+        mLastReportSeconds = elapsedSeconds;
+        std::cerr << makeReportLine(elapsedSeconds) << std::endl;
+    }
+
+    if (isDone) {
+        finish(elapsedSeconds);
+    }
+}
+
+//==============================================================================
+juce::String SoakTest::makeReportLine(double const elapsedSeconds)
+{
+    juce::String line{ "[" + juce::RelativeTime{ elapsedSeconds }.getDescription() + "] " };
+
+    auto const * stats{ getCallbackMonitor().getMostRecentStats() };
+    if (!stats) {
+        return line + "no audio callback yet.";
+    }
+
+    auto * const device{ getAudioDevice() };
+    auto const xRuns{ device ? getCallbackMonitor().getXRunsSinceReset(*device) : -1 };
+    line << static_cast<juce::int64>(stats->numCallbacks)
+         << " callbacks, dropped: " << (xRuns < 0 ? juce::String{ "?" } : juce::String{ xRuns }) << " xruns";
+    for (std::size_t i{}; i < NUM_SKIPPED_BLOCK_REASONS; ++i) {
+        if (stats->skippedBlocks[i] > 0) {
+            line << ", " << static_cast<juce::int64>(stats->skippedBlocks[i]) << " "
+                 << skippedBlockReasonToString(static_cast<SkippedBlockReason>(i));
+        }
+    }
+
+    auto const describe = [](DurationHistogram const & histogram) {
+        return "p50 " + juce::String{ histogram.getPercentileMs(50.0), 3 } + " p99 "
+               + juce::String{ histogram.getPercentileMs(99.0), 3 } + " p99.9 "
+               + juce::String{ histogram.getPercentileMs(99.9), 3 } + " max "
+               + juce::String{ histogram.maxMs, 3 } + " ms";
+    };
+    line << " | process " << describe(stats->processingTime) << " (block "
+         << juce::String{ stats->blockDurationMs, 3 } << " ms) | jitter " << describe(stats->jitter);
+
+    line << " | osc " << static_cast<juce::int64>(mLoadGenerator->getNumSent()) << " sent";
+    if (auto const numFailed{ mLoadGenerator->getNumFailed() }; numFailed > 0) {
+        line << ", " << static_cast<juce::int64>(numFailed) << " failed";
+    }
+    if (auto const numLateTicks{ mLoadGenerator->getNumLateTicks() }; numLateTicks > 0) {
+        line << ", " << static_cast<juce::int64>(numLateTicks) << " late ticks";
+    }
+
+    auto const oscStats{ mServer->getOscStats() };
+    line << " | server lock wait " << describe(oscStats.lockWait) << ", updateSpatData "
+         << describe(oscStats.updateSpatData);
+    return line;
+}
+
+//==============================================================================
+void SoakTest::finish(double const elapsedSeconds)
+{
+    stopTimer();
+    mLoadGenerator->stopThread(-1);
+
+    auto * summary{ new juce::DynamicObject{} };
+    summary->setProperty("version", juce::JUCEApplication::getInstance()->getApplicationVersion());
+    summary->setProperty("cpu", juce::SystemStats::getCpuModel());
+    summary->setProperty("numCpus", juce::SystemStats::getNumCpus());
+    summary->setProperty("seconds", elapsedSeconds);
+    summary->setProperty("rateHz", mOptions.rateHz);
+    summary->setProperty("oscSent", static_cast<juce::int64>(mLoadGenerator->getNumSent()));
+    summary->setProperty("oscFailed", static_cast<juce::int64>(mLoadGenerator->getNumFailed()));
+    summary->setProperty("oscLateTicks", static_cast<juce::int64>(mLoadGenerator->getNumLateTicks()));
+
+    std::uint64_t numDropped{};
+    auto * const device{ getAudioDevice() };
+    if (device) {
+        summary->setProperty("device", device->getName());
+        summary->setProperty("sampleRate", device->getCurrentSampleRate());
+        summary->setProperty("bufferSize", device->getCurrentBufferSizeSamples());
+        auto const xRuns{ getCallbackMonitor().getXRunsSinceReset(*device) };
+        summary->setProperty("xruns", xRuns < 0 ? juce::var{} : juce::var{ xRuns });
+        numDropped += static_cast<std::uint64_t>(std::max(0, xRuns));
+    }
+
+    if (auto const * stats{ getCallbackMonitor().getMostRecentStats() }) {
+        summary->setProperty("callbacks", static_cast<juce::int64>(stats->numCallbacks));
+        auto * skipped{ new juce::DynamicObject{} };
+        for (std::size_t i{}; i < NUM_SKIPPED_BLOCK_REASONS; ++i) {
+            skipped->setProperty(skippedBlockReasonToString(static_cast<SkippedBlockReason>(i)).toLowerCase(),
+                                 static_cast<juce::int64>(stats->skippedBlocks[i]));
+        }
+        summary->setProperty("skippedBlocks", juce::var{ skipped });
+        numDropped += stats->getNumSkippedBlocks();
+
+        auto const toVar = [](DurationHistogram const & histogram) {
+            auto * percentiles{ new juce::DynamicObject{} };
+            for (auto const percentile : { 50.0, 90.0, 99.0, 99.9, 99.99 }) {
+                percentiles->setProperty("p" + juce::String{ percentile }, histogram.getPercentileMs(percentile));
+            }
+            percentiles->setProperty("max", histogram.maxMs);
+            return juce::var{ percentiles };
+        };
+        summary->setProperty("blockMs", stats->blockDurationMs);
+        summary->setProperty("processMs", toVar(stats->processingTime));
+        summary->setProperty("jitterMs", toVar(stats->jitter));
+
+        auto const oscStats{ mServer->getOscStats() };
+        summary->setProperty("oscLockWaitMs", toVar(oscStats.lockWait));
+        summary->setProperty("oscUpdateSpatDataMs", toVar(oscStats.updateSpatData));
+    }
+    summary->setProperty("droppedBlocks", static_cast<juce::int64>(numDropped));
+
+    auto const json{ juce::JSON::toString(juce::var{ summary }) };
+    auto exitCode{ numDropped > 0 ? 2 : 0 };
+    if (mOptions.output == juce::File{}) {
+        std::cout << json << std::endl;
+    } else if (!mOptions.output.replaceWithText(json)) {
+        std::cerr << "Error: unable to write \"" << mOptions.output.getFullPathName() << "\"." << std::endl;
+        exitCode = 1;
+    }
+
+    juce::JUCEApplicationBase::getInstance()->setApplicationReturnValue(exitCode);
+    juce::JUCEApplicationBase::quit();
+}
+} // namespace gris
@@ -0,0 +1,156 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_Macros.hpp"
+#include "sg_AudioCallbackMonitor.hpp"
+#include "sg_HeadlessServer.hpp"
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace gris
+{
+/* Runs the whole engine for a long time under OSC load and reports how it held :
+
+     SpatGRIS --soak [--duration=<seconds>[s|m|h]] [--sources=<count>] [--rate=<hz>]
+                     [--report-interval=<seconds>] [--output=<file.json>] [--real-device]
+                     [--project=<file>] [--speakers=<file>] [--osc-port=<port>]
+                     [--sample-rate=<hz>] [--buffer-size=<samples>]
+
+   A HeadlessServer is started on the simulated audio device, unless
+   --real-device keeps the one of the settings. A load generator thread then
+   sends /spat/serv deg messages to it through the loopback interface, moving
+   every source around the listener --rate times per second, which is what a
+   busy ControlGRIS session looks like.
+
+   Every --report-interval seconds, a line goes to the standard error with :
+
+     dropped   : device xruns, and the blocks the callback skipped, by reason.
+     process   : the distribution of the time spent in the callback.
+     jitter    : the distribution of the distance between the actual and the
+                 expected interval between two callbacks.
+     osc       : the messages sent, and the ticks where the generator itself
+                 fell behind.
+     server    : where the server's OSC thread spent its time : waiting for
+                 the lock it shares with the message thread, and handing the
+                 positions over to the algorithm in updateSpatData(), which is
+                 all it shares with the audio callback. Nothing on the OSC
+                 path takes the processor lock, so the blocks skipped for that
+                 reason come from elsewhere (recorders, device changes).
+
+   The test stops after --duration or on SIGINT or SIGTERM. A JSON summary is
+   then written, to the standard output unless --output is given, and the
+   process returns 2 if any block was dropped.
+*/
+class SoakTest final : private juce::Timer
+{
+public:
+    static constexpr auto const * SOAK_OPTION = "--soak";
+
+    //==============================================================================
+    struct Options {
+        HeadlessServer::Options server{};
+        double durationSeconds{ 3600.0 };
+        // 0 moves every source of the project.
+        int numSources{};
+        double rateHz{ 50.0 };
+        int reportIntervalSeconds{ 60 };
+        juce::File output{};
+    };
+
+private:
+    static constexpr int DEFAULT_OSC_PORT = 18099;
+    static constexpr int TIMER_INTERVAL_MS = 250;
+
+    //==============================================================================
+    /* Sends the positions from a thread of its own, so that the message thread is free to report. */
+    class LoadGenerator final : public juce::Thread
+    {
+        int mOscPort;
+        int mNumSources;
+        double mRateHz;
+        std::atomic<std::uint64_t> mNumSent{};
+        std::atomic<std::uint64_t> mNumFailed{};
+        std::atomic<std::uint64_t> mNumLateTicks{};
+
+    public:
+        //==============================================================================
+        LoadGenerator(int const oscPort, int const numSources, double const rateHz)
+            : juce::Thread("Soak test load generator")
+            , mOscPort(oscPort)
+            , mNumSources(numSources)
+            , mRateHz(rateHz)
+        {
+        }
+        LoadGenerator() = delete;
+        ~LoadGenerator() override { stopThread(-1); }
+        SG_DELETE_COPY_AND_MOVE(LoadGenerator)
+        //==============================================================================
+        [[nodiscard]] std::uint64_t getNumSent() const noexcept { return mNumSent.load(); }
+        [[nodiscard]] std::uint64_t getNumFailed() const noexcept { return mNumFailed.load(); }
+        [[nodiscard]] std::uint64_t getNumLateTicks() const noexcept { return mNumLateTicks.load(); }
+
+    private:
+        //==============================================================================
+        void run() override;
+        //==============================================================================
+        JUCE_LEAK_DETECTOR(LoadGenerator)
+    };
+
+    //==============================================================================
+    Options mOptions{};
+    std::unique_ptr<HeadlessServer> mServer{};
+    std::unique_ptr<LoadGenerator> mLoadGenerator{};
+    juce::int64 mStartTicks{};
+    double mLastReportSeconds{};
+
+    static inline std::atomic<bool> mStopRequested{};
+
+public:
+    //==============================================================================
+    explicit SoakTest(Options options) : mOptions(std::move(options)) {}
+    SoakTest() = delete;
+    ~SoakTest() override;
+    SG_DELETE_COPY_AND_MOVE(SoakTest)
+    //==============================================================================
+    [[nodiscard]] static juce::String getUsage();
+    [[nodiscard]] static tl::optional<Options> parseOptions(juce::ArgumentList const & arguments,
+                                                            juce::String & error);
+    /* Starts the server and the load generator. The test then runs until it is done or the process is asked to stop. */
+    [[nodiscard]] bool start(juce::String & error);
+
+private:
+    //==============================================================================
+    static void requestStop(int /*signal*/) { mStopRequested.store(true); }
+    [[nodiscard]] static AudioCallbackMonitor & getCallbackMonitor();
+    [[nodiscard]] static juce::AudioIODevice * getAudioDevice();
+    [[nodiscard]] double getElapsedSeconds() const;
+    //==============================================================================
+    void timerCallback() override;
+    [[nodiscard]] juce::String makeReportLine(double const elapsedSeconds);
+    void finish(double const elapsedSeconds);
+
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(SoakTest)
+};
+} // namespace gris
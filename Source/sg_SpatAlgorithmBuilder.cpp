@@ -0,0 +1,216 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sg_SpatAlgorithmBuilder.hpp"
+
+#include "sg_MulticoreTuning.hpp"
+#include "sg_ThreadPlacement.hpp"
+
+#include <utility>
+
+namespace gris
+{
+//==============================================================================
+SpatAlgorithmBuilder::SpatAlgorithmBuilder(Callback onBuilt)
+    : juce::Thread("SpatAlgorithmBuilder")
+    , mOnBuilt(std::move(onBuilt))
+{
+    startThread();
+}
+
+//==============================================================================
+SpatAlgorithmBuilder::~SpatAlgorithmBuilder()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    cancel();
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    mWakeUp.signal();
+    // The worker gives its build up at the next step, but the algorithm that AlgoGRIS is building has to finish.
+    stopThread(-1);
+}
+
+//==============================================================================
+bool SpatAlgorithmBuilder::build(SpatGrisData const & data)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    auto inputs{ describeInputs(data) };
+    if (isBuilding() && inputs == mLatestInputs) {
+        return true;
+    }
+    if (inputs == mBuiltInputs) {
+        cancel();
+        return false;
+    }
+    return request(data, std::move(inputs), false);
+}
+
+//==============================================================================
+void SpatAlgorithmBuilder::calibrate(SpatGrisData const & data)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    request(data, describeInputs(data), true);
+}
+
+//==============================================================================
+std::unique_ptr<AbstractSpatAlgorithm> SpatAlgorithmBuilder::buildNow(SpatGrisData const & data)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    cancel();
+    mBuiltInputs = describeInputs(data);
+    return session::makeSpatAlgorithm(data, mLastOutcome);
+}
+
+//==============================================================================
+juce::String SpatAlgorithmBuilder::getStatus() const
+{
+    if (!isBuilding()) {
+        return {};
+    }
+    auto const elapsedSeconds{ static_cast<double>(juce::Time::getMillisecondCounter() - mStartTime) / 1000.0 };
+    return mDescription + " (" + juce::String{ elapsedSeconds, 1 } + " s)...";
+}
+
+//==============================================================================
+bool SpatAlgorithmBuilder::request(SpatGrisData const & data, juce::String inputs, bool const shouldCalibrate)
+{
+    auto job{ std::make_unique<Job>() };
+    job->data = makeSnapshot(data);
+    if (!job->data) {
+        jassertfalse;
+        return false;
+    }
+    job->inputs = inputs;
+    job->shouldCalibrate = shouldCalibrate;
+    job->serial = mLatestSerial.load() + 1;
+    mLatestSerial.store(job->serial);
+    mLatestInputs = std::move(inputs);
+
+    auto const & speakerSetup{ job->data->speakerSetup };
+    auto const spatMode{ juce::String{ spatModeToString(job->data->project.spatMode) } };
+    auto const numSpeakers{ juce::String{ speakerSetup.speakers.size() } };
+    mDescription = shouldCalibrate && job->data->project.spatMode != SpatMode::hybrid
+                       ? "Calibrating the multicore DSP of the " + spatMode + " spatialization for " + numSpeakers
+                             + " speakers on " + juce::String{ juce::SystemStats::getNumCpus() } + " cores"
+                       : "Building the " + spatMode + " spatialization for " + numSpeakers + " speakers";
+    mStartTime = juce::Time::getMillisecondCounter();
+
+    std::unique_ptr<Job> abandonedJob{};
+    {
+        juce::ScopedLock const lock{ mJobsLock };
+        abandonedJob = std::exchange(mPendingJob, std::move(job));
+    }
+    mWakeUp.signal();
+    return true;
+}
+
+//==============================================================================
+juce::String SpatAlgorithmBuilder::describeInputs(SpatGrisData const & data)
+{
+    auto const & project{ data.project };
+    auto const & appData{ data.appData };
+
+    juce::String result{ data.speakerSetup.toXml()->toString(juce::XmlElement::TextFormat{}.singleLine()) };
+    result << "|" << spatModeToString(project.spatMode) << "|" << static_cast<int>(project.useMulticoreDSP) << "|"
+           << project.multicoreDSPPreset << "|" << static_cast<int>(multicoreTuning::isEnabled()) << "|"
+           << (appData.stereoMode ? static_cast<int>(*appData.stereoMode) : -1) << "|"
+           << appData.audioSettings.sampleRate << "|" << appData.audioSettings.bufferSize << "|"
+           << static_cast<int>(appData.binauralSettings.useDefaultBinauralProfile) << "|"
+           << appData.binauralSettings.lastSofaFile;
+    for (auto const & source : project.sources) {
+        result << "|" << source.key.get() << ":" << spatModeToString(source.value->hybridSpatMode);
+    }
+    return result;
+}
+
+//==============================================================================
+std::unique_ptr<SpatGrisData> SpatAlgorithmBuilder::makeSnapshot(SpatGrisData const & data)
+{
+    auto project{ ProjectData::fromXml(*data.project.toXml()) };
+    auto speakerSetup{ SpeakerSetup::fromXml(*data.speakerSetup.toXml()) };
+    auto appData{ AppData::fromXml(*data.appData.toXml()) };
+    if (!project || !speakerSetup || !appData) {
+        return nullptr;
+    }
+
+    auto snapshot{ std::make_unique<SpatGrisData>() };
+    snapshot->project = std::move(*project);
+    snapshot->speakerSetup = std::move(*speakerSetup);
+    snapshot->appData = std::move(*appData);
+    return snapshot;
+}
+
+//==============================================================================
+void SpatAlgorithmBuilder::run()
+{
+    threadPlacement::applyToCurrentThread(threadPlacement::Role::ui);
+
+    while (!threadShouldExit()) {
+        mWakeUp.wait(-1);
+
+        std::unique_ptr<Job> job{};
+        {
+            juce::ScopedLock const lock{ mJobsLock };
+            job = std::move(mPendingJob);
+        }
+        if (!job) {
+            continue;
+        }
+
+        auto const shouldStop = [this, serial = job->serial] {
+            return threadShouldExit() || serial != mLatestSerial.load() || serial <= mCancelledSerial.load();
+        };
+        if (!shouldStop()) {
+            job->result = job->shouldCalibrate ? session::calibrate(*job->data, job->outcome, shouldStop)
+                                               : session::makeSpatAlgorithm(*job->data, job->outcome, shouldStop);
+        }
+
+        {
+            juce::ScopedLock const lock{ mJobsLock };
+            mFinishedJobs.add(job.release());
+        }
+        triggerAsyncUpdate();
+    }
+}
+
+//==============================================================================
+void SpatAlgorithmBuilder::handleAsyncUpdate()
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+
+    juce::OwnedArray<Job> finishedJobs{};
+    {
+        juce::ScopedLock const lock{ mJobsLock };
+        finishedJobs.swapWith(mFinishedJobs);
+    }
+
+    for (auto * job : finishedJobs) {
+        if (job->serial != mLatestSerial.load() || job->serial == mDeliveredSerial || !job->result) {
+            continue;
+        }
+        mDeliveredSerial = job->serial;
+        mBuiltInputs = job->inputs;
+        mLastOutcome = std::move(job->outcome);
+        mOnBuilt(std::move(job->result));
+    }
+}
+} // namespace gris
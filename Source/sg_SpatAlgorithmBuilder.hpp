@@ -0,0 +1,149 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_LogicStrucs.hpp"
+#include "Data/sg_Macros.hpp"
+#include "sg_AbstractSpatAlgorithm.hpp"
+#include "sg_SessionUtilities.hpp"
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace gris
+{
+/* Builds spatialization algorithms on a worker thread.
+
+   Triangulating a dome or laying out a cube field takes seconds with a few
+   hundred speakers. build() takes a snapshot of the data and returns at once :
+   the message thread stays responsive and the audio thread keeps rendering
+   with the current algorithm. The callback is called on the message thread
+   once the algorithm is ready.
+
+   Requesting a new build or calling cancel() stops the previous one : it is
+   dropped before it starts if it is still waiting, and otherwise the worker
+   gives it up at the next step of session::makeSpatAlgorithm() or
+   session::calibrate(). An algorithm that AlgoGRIS is building cannot be
+   interrupted, so that step still runs to its end. Only the most recent
+   request is ever delivered.
+
+   A request whose inputs are the same as the ones of the current algorithm
+   builds nothing : editing the speaker setup often ends in a refresh that does
+   not change the geometry (an edit that is undone, a group that is renamed,
+   a value typed again), and every build triangulates the whole setup again.
+
+   calibrate() is the only request that times anything, and only when the
+   operator asks for it : see session::calibrate(). The live renderer keeps
+   playing meanwhile. The multicore preset and the tuning choice that come
+   with an algorithm are only applied when it is delivered, on the message
+   thread : see getLastOutcome().
+*/
+class SpatAlgorithmBuilder final
+    : private juce::Thread
+    , private juce::AsyncUpdater
+{
+public:
+    using Callback = std::function<void(std::unique_ptr<AbstractSpatAlgorithm>)>;
+
+private:
+    //==============================================================================
+    struct Job {
+        std::unique_ptr<SpatGrisData> data{};
+        juce::String inputs{};
+        int serial{};
+        bool shouldCalibrate{};
+        std::unique_ptr<AbstractSpatAlgorithm> result{};
+        session::BuildOutcome outcome{};
+    };
+    //==============================================================================
+    Callback mOnBuilt;
+    juce::CriticalSection mJobsLock{};
+    // Message thread -> worker.
+    std::unique_ptr<Job> mPendingJob{};
+    // Worker -> message thread. Jobs are always freed on the message thread.
+    juce::OwnedArray<Job> mFinishedJobs{};
+    juce::WaitableEvent mWakeUp{};
+    std::atomic<int> mLatestSerial{};
+    // Requests up to this one were cancelled.
+    std::atomic<int> mCancelledSerial{};
+    // Message thread only.
+    int mDeliveredSerial{};
+    // What the current algorithm and the latest request were built from, see describeInputs().
+    juce::String mBuiltInputs{};
+    juce::String mLatestInputs{};
+    juce::String mDescription{};
+    session::BuildOutcome mLastOutcome{};
+    juce::uint32 mStartTime{};
+
+public:
+    //==============================================================================
+    explicit SpatAlgorithmBuilder(Callback onBuilt);
+    SpatAlgorithmBuilder() = delete;
+    ~SpatAlgorithmBuilder() override;
+    SG_DELETE_COPY_AND_MOVE(SpatAlgorithmBuilder)
+    //==============================================================================
+    /* Message thread. Starts building an algorithm for the data, cancelling the previous request unless it was for the
+       same inputs. Returns false if the current algorithm was built from the same inputs, in which case nothing is
+       built. */
+    [[nodiscard]] bool build(SpatGrisData const & data);
+
+    /* Message thread. Starts building the algorithm for the data with and without multicore DSP and keeps the fastest,
+       see session::calibrate(). Cancels the previous request, even if it was for the same inputs. */
+    void calibrate(SpatGrisData const & data);
+
+    /* Message thread. Builds an algorithm for the data on the calling thread, cancelling the current request. */
+    [[nodiscard]] std::unique_ptr<AbstractSpatAlgorithm> buildNow(SpatGrisData const & data);
+
+    /* Message thread. Stops the current request, if any, and drops its result. */
+    void cancel() noexcept
+    {
+        JUCE_ASSERT_MESSAGE_THREAD;
+        mDeliveredSerial = mLatestSerial.load();
+        mCancelledSerial.store(mDeliveredSerial);
+    }
+
+    /* Message thread. True from a call to build() or calibrate() until its callback. */
+    [[nodiscard]] bool isBuilding() const noexcept { return mDeliveredSerial != mLatestSerial.load(); }
+
+    /* Message thread. Describes the current build, or returns an empty string. */
+    [[nodiscard]] juce::String getStatus() const;
+
+    /* Message thread. What session::makeSpatAlgorithm() or session::calibrate() chose for the current algorithm, to be
+       given to session::adopt() along with it. */
+    [[nodiscard]] session::BuildOutcome const & getLastOutcome() const noexcept { return mLastOutcome; }
+
+private:
+    //==============================================================================
+    bool request(SpatGrisData const & data, juce::String inputs, bool shouldCalibrate);
+    /* Everything session::makeSpatAlgorithm() reads. The sources' positions are left out : they are assigned to the
+       algorithm once it is built. */
+    [[nodiscard]] static juce::String describeInputs(SpatGrisData const & data);
+    /* The data cannot be copied, and the worker must not read it while the message thread modifies it. */
+    [[nodiscard]] static std::unique_ptr<SpatGrisData> makeSnapshot(SpatGrisData const & data);
+    //==============================================================================
+    void run() override;
+    void handleAsyncUpdate() override;
+    //==============================================================================
+    JUCE_LEAK_DETECTOR(SpatAlgorithmBuilder)
+};
+} // namespace gris
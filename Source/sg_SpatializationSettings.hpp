@@ -0,0 +1,73 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace gris
+{
+/* The settings file of the multicore tuning and the thread placement.
+
+   It is stored apart from the main settings file, like the JACK virtual ports
+   (see sg_JackVirtualPorts.hpp), and every feature goes through the single
+   instance returned by get() : separate instances of the same file would each
+   save their own copy of it and lose the keys written by the others.
+
+   Reading is allowed from any thread, since juce::PropertySet locks itself.
+   Writing is for the message thread only, so that the read-modify-write of a
+   feature cannot interleave with another one's. Nothing is saved until
+   saveIfNeeded() is called.
+*/
+namespace spatializationSettings
+{
+//==============================================================================
+[[nodiscard]] inline juce::PropertiesFile::Options storageOptions()
+{
+    juce::PropertiesFile::Options options{};
+    options.applicationName = "SpatGRIS-spatialization";
+    options.commonToAllUsers = false;
+    options.filenameSuffix = "xml";
+    options.folderName = "GRIS";
+    options.storageFormat = juce::PropertiesFile::storeAsXML;
+    options.ignoreCaseOfKeyNames = true;
+    options.millisecondsBeforeSaving = -1;
+    options.osxLibrarySubFolder = "Application Support";
+    return options;
+}
+
+namespace detail
+{
+class Instance final : private juce::DeletedAtShutdown
+{
+public:
+    juce::PropertiesFile file{ storageOptions() };
+};
+} // namespace detail
+
+//==============================================================================
+/* Created on first use, deleted with the other DeletedAtShutdown objects when the application quits. */
+[[nodiscard]] inline juce::PropertiesFile & get()
+{
+    static auto * const instance{ new detail::Instance{} };
+    return instance->file;
+}
+
+} // namespace spatializationSettings
+} // namespace gris
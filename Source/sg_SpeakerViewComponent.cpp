@@ -20,6 +20,7 @@
 #include "sg_SpeakerViewComponent.hpp"
 
 #include "sg_MainComponent.hpp"
+#include "sg_ThreadPlacement.hpp"
 
 #include <algorithm>
 
@@ -376,6 +377,9 @@ void SpeakerViewComponent::prepareSpeakersJson()
 
 void SpeakerViewComponent::hiResTimerCallback()
 {
+    if (auto const threadId{ juce::Thread::getCurrentThreadId() }; threadId != mHighResTimerThreadID) {
+        threadPlacement::applyToCurrentThread(threadPlacement::Role::ui);
+    }
     mHighResTimerThreadID = juce::Thread::getCurrentThreadId();
 
     juce::ScopedLock const lock{ mLock };
@@ -0,0 +1,357 @@
+/*
+ This file is part of SpatGRIS.
+
+ Developers: Gaël Lane Lépine, Samuel Béland, Olivier Bélanger, Nicolas Masson
+
+ SpatGRIS is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ SpatGRIS is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with SpatGRIS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Data/sg_Macros.hpp"
+#include "sg_SpatializationSettings.hpp"
+#include "tl/optional.hpp"
+
+#include <JuceHeader.h>
+
+#include <array>
+
+#if JUCE_LINUX
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/types.h>
+#endif
+
+namespace gris
+{
+/* Pins the threads SpatGRIS creates to sets of CPUs and gives them SCHED_FIFO
+   priorities, for machines where the audio has cores of its own.
+
+   A placement is written as a list of rules, one per role, and an optional
+   "mlockall" that locks the process' memory at startup :
+
+     audio=2-3:80 dsp=4-15:70 disk=16-17 ui=0-1,18-31 mlockall
+
+   Each rule is <role>=<cpus>[:<priority>], where the cpus are a list of
+   numbers and ranges and the priority is a SCHED_FIFO priority (1 to 99). A
+   role without a rule, or without a priority, is left alone.
+
+     audio : the audio callback, applied the first time it runs on a thread.
+     dsp   : the multicore DSP workers. They are spawned by the algorithm when
+             it is built, with no hook to place them, so they are found and
+             placed right after : see ScopedSpawnedThreadsRole. The thread
+             building the algorithm keeps its own placement.
+     disk  : the player and recorders threads.
+     ui    : the message thread, the SpeakerView thread and the spatialization
+             builder. Threads started later by the message thread (OSC, JUCE
+             internals) inherit its CPUs.
+
+   The placement is read once at startup, from the command line (--threads=)
+   or from the settings, and is fixed for the life of the process. Only Linux
+   supports it : everything here is a no-op elsewhere.
+*/
+namespace threadPlacement
+{
+enum class Role { audio, dsp, disk, ui };
+constexpr std::array<char const *, 4> ROLE_NAMES{ "audio", "dsp", "disk", "ui" };
+constexpr auto const * LOCK_MEMORY_TOKEN = "mlockall";
+constexpr auto const * OPTION = "--threads";
+
+//==============================================================================
+struct Rule {
+    // Empty means any CPU.
+    juce::Array<int> cpus{};
+    // 0 leaves the scheduling policy alone.
+    int fifoPriority{};
+
+    [[nodiscard]] bool isEmpty() const noexcept { return cpus.isEmpty() && fifoPriority == 0; }
+};
+
+struct Placement {
+    std::array<Rule, ROLE_NAMES.size()> rules{};
+    bool lockMemory{};
+
+    [[nodiscard]] Rule const & operator[](Role const role) const noexcept
+    {
+        return rules[static_cast<std::size_t>(role)];
+    }
+};
+
+[[nodiscard]] inline constexpr bool isSupported()
+{
+#if JUCE_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+//==============================================================================
+[[nodiscard]] inline tl::optional<Placement> parse(juce::String const & spec, juce::String & error)
+{
+    Placement result{};
+
+    auto const tokens{ juce::StringArray::fromTokens(spec, false) };
+    for (auto const & token : tokens) {
+        if (token == LOCK_MEMORY_TOKEN) {
+            result.lockMemory = true;
+            continue;
+        }
+
+        auto const roleName{ token.upToFirstOccurrenceOf("=", false, false) };
+        std::size_t roleIndex{};
+        while (roleIndex < ROLE_NAMES.size() && roleName != ROLE_NAMES[roleIndex]) {
+            ++roleIndex;
+        }
+        if (roleIndex == ROLE_NAMES.size() || !token.containsChar('=')) {
+            error = "Unknown thread placement rule \"" + token + "\".";
+            return tl::nullopt;
+        }
+
+        auto & rule{ result.rules[roleIndex] };
+        auto const value{ token.fromFirstOccurrenceOf("=", false, false) };
+        auto const cpus{ juce::StringArray::fromTokens(value.upToFirstOccurrenceOf(":", false, false), ",", {}) };
+        for (auto const & range : cpus) {
+            auto const first{ range.upToFirstOccurrenceOf("-", false, false) };
+            auto const last{ range.containsChar('-') ? range.fromFirstOccurrenceOf("-", false, false) : first };
+            if (!first.containsOnly("0123456789") || !last.containsOnly("0123456789") || first.isEmpty()
+                || last.isEmpty() || last.getIntValue() < first.getIntValue()) {
+                error = "Invalid CPUs \"" + range + "\" in \"" + token + "\".";
+                return tl::nullopt;
+            }
+            for (auto cpu{ first.getIntValue() }; cpu <= last.getIntValue(); ++cpu) {
+                rule.cpus.addIfNotAlreadyThere(cpu);
+            }
+        }
+
+        if (value.containsChar(':')) {
+            auto const priority{ value.fromFirstOccurrenceOf(":", false, false) };
+            if (!priority.containsOnly("0123456789") || priority.getIntValue() < 1 || priority.getIntValue() > 99) {
+                error = "The priority in \"" + token + "\" must be between 1 and 99.";
+                return tl::nullopt;
+            }
+            rule.fifoPriority = priority.getIntValue();
+        }
+    }
+
+    return result;
+}
+
+//==============================================================================
+namespace detail
+{
+[[nodiscard]] inline Placement & getMutable() noexcept
+{
+    static Placement placement{};
+    return placement;
+}
+} // namespace detail
+
+/* Message thread, at startup, before any audio device is opened or any thread is started. */
+inline void configure(Placement const & placement)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    detail::getMutable() = placement;
+}
+
+/* Fixed once configured, so it can be read from any thread, the audio thread included. */
+[[nodiscard]] inline Placement const & get() noexcept
+{
+    return detail::getMutable();
+}
+
+//==============================================================================
+#if JUCE_LINUX
+namespace detail
+{
+[[nodiscard]] inline cpu_set_t makeCpuSet(Rule const & rule) noexcept
+{
+    cpu_set_t cpus{};
+    CPU_ZERO(&cpus);
+    for (auto const cpu : rule.cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    return cpus;
+}
+} // namespace detail
+#endif
+
+/* Applies the role's rule to the calling thread. Returns false if the system refused some of it, which usually means
+   that the user is not allowed to use realtime scheduling. */
+inline bool applyToCurrentThread([[maybe_unused]] Role const role)
+{
+#if JUCE_LINUX
+    auto const & rule{ get()[role] };
+    auto success{ true };
+
+    if (!rule.cpus.isEmpty()) {
+        auto const cpus{ detail::makeCpuSet(rule) };
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            success = false;
+        }
+    }
+
+    if (rule.fifoPriority > 0) {
+        sched_param param{};
+        param.sched_priority = rule.fifoPriority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+            success = false;
+        }
+    }
+
+    return success;
+#else
+    return true;
+#endif
+}
+
+//==============================================================================
+/* Gives a role to the threads that the calling thread starts until the end of the scope, for code that starts them
+   without a hook to place them, such as the multicore DSP workers. The calling thread keeps its own placement.
+
+   On Linux, a thread starts with the name of the thread that created it : the threads of the process that appeared
+   during the scope with the name of the calling thread are placed when it ends. They run with the placement of the
+   calling thread until then. */
+class ScopedSpawnedThreadsRole
+{
+#if JUCE_LINUX
+    Role mRole{};
+    bool mIsNeeded{};
+    juce::String mCallerName{};
+    juce::StringArray mThreadsBefore{};
+#endif
+
+public:
+    //==============================================================================
+    explicit ScopedSpawnedThreadsRole([[maybe_unused]] Role const role)
+    {
+#if JUCE_LINUX
+        if (get()[role].isEmpty()) {
+            return;
+        }
+        mRole = role;
+        mIsNeeded = true;
+        mCallerName = getThreadName(juce::File{ "/proc/thread-self" });
+        mThreadsBefore = getThreadIds();
+#endif
+    }
+    ~ScopedSpawnedThreadsRole()
+    {
+#if JUCE_LINUX
+        if (!mIsNeeded) {
+            return;
+        }
+        for (auto const & threadId : getThreadIds()) {
+            if (!mThreadsBefore.contains(threadId)
+                && getThreadName(juce::File{ "/proc/self/task" }.getChildFile(threadId)) == mCallerName) {
+                applyTo(static_cast<pid_t>(threadId.getIntValue()));
+            }
+        }
+#endif
+    }
+    ScopedSpawnedThreadsRole() = delete;
+    SG_DELETE_COPY_AND_MOVE(ScopedSpawnedThreadsRole)
+
+#if JUCE_LINUX
+private:
+    //==============================================================================
+    [[nodiscard]] static juce::String getThreadName(juce::File const & threadDirectory)
+    {
+        return threadDirectory.getChildFile("comm").loadFileAsString().trim();
+    }
+
+    [[nodiscard]] static juce::StringArray getThreadIds()
+    {
+        juce::StringArray result{};
+        for (auto const & entry : juce::RangedDirectoryIterator{ juce::File{ "/proc/self/task" },
+                                                                 false,
+                                                                 "*",
+                                                                 juce::File::findDirectories }) {
+            result.add(entry.getFile().getFileName());
+        }
+        return result;
+    }
+
+    /* Same as applyToCurrentThread(), for another thread of the process. */
+    void applyTo(pid_t const threadId) const
+    {
+        auto const & rule{ get()[mRole] };
+        if (!rule.cpus.isEmpty()) {
+            auto const cpus{ detail::makeCpuSet(rule) };
+            sched_setaffinity(threadId, sizeof(cpus), &cpus);
+        }
+        if (rule.fifoPriority > 0) {
+            sched_param param{};
+            param.sched_priority = rule.fifoPriority;
+            sched_setscheduler(threadId, SCHED_FIFO, &param);
+        }
+    }
+#endif
+};
+
+//==============================================================================
+/* Applies the role to the thread of a juce::TimeSliceThread : add it as a client once the thread is started. */
+class TimeSliceClient final : public juce::TimeSliceClient
+{
+    Role mRole;
+
+public:
+    explicit TimeSliceClient(Role const role) : mRole(role) {}
+    TimeSliceClient() = delete;
+    ~TimeSliceClient() override = default;
+    SG_DELETE_COPY_AND_MOVE(TimeSliceClient)
+
+    int useTimeSlice() override
+    {
+        applyToCurrentThread(mRole);
+        // Removes the client from the thread.
+        return -1;
+    }
+};
+
+//==============================================================================
+/* Message thread, at startup. Returns false if the memory could not be locked. */
+inline bool lockMemoryIfNeeded()
+{
+#if JUCE_LINUX
+    if (get().lockMemory) {
+        return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+    }
+#endif
+    return true;
+}
+
+//==============================================================================
+constexpr auto const * SPEC_KEY = "threadPlacement";
+
+[[nodiscard]] inline juce::String loadSpec()
+{
+    auto const & storage{ spatializationSettings::get() };
+    return storage.getValue(SPEC_KEY);
+}
+
+/* Takes effect the next time SpatGRIS starts. */
+inline void storeSpec(juce::String const & spec)
+{
+    JUCE_ASSERT_MESSAGE_THREAD;
+    auto & storage{ spatializationSettings::get() };
+    storage.setValue(SPEC_KEY, spec.trim());
+    storage.saveIfNeeded();
+}
+
+} // namespace threadPlacement
+} // namespace gris